@@ -0,0 +1,58 @@
+// Measures the throughput of writing thousands of generated files with each
+// durability level, relative to plain atomic renames without any fsync.
+//
+//   make benchmark && ./output_durability_benchmark [directory] [files]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include "../source/output_directory.hpp"
+
+namespace fs = std::filesystem;
+
+static double write_files(const fs::path &directory, Durability durability,
+                          std::size_t file_count) {
+  fs::remove_all(directory);
+  std::string content(2048, 'x');
+
+  auto start = std::chrono::steady_clock::now();
+  {
+    OutputDirectory output(directory.string(), durability);
+    for (std::size_t i = 0; i < file_count; i++) {
+      content.replace(0, 20, std::to_string(i) + std::string(20, ' '), 0, 20);
+      output.write_if_changed("Class" + std::to_string(i) + ".hpp", content);
+    }
+    output.commit();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return file_count / elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+  fs::path directory = argc > 1 ? argv[1] : "durability_benchmark_output";
+  std::size_t file_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5000;
+
+  struct Level {
+    const char *name;
+    Durability durability;
+  } levels[] = {{"none", Durability::None},
+                {"batched", Durability::Batched},
+                {"per-file", Durability::PerFile}};
+
+  double baseline = 0;
+  std::printf("%10s %14s %10s\n", "durability", "files/s", "vs none");
+  for (const Level &level : levels) {
+    double files_per_second = write_files(directory, level.durability,
+                                          file_count);
+    if (level.durability == Durability::None)
+      baseline = files_per_second;
+    std::printf("%10s %14.0f %9.1f%%\n", level.name, files_per_second,
+                100.0 * (files_per_second / baseline - 1.0));
+  }
+  fs::remove_all(directory);
+  return 0;
+}
@@ -0,0 +1,58 @@
+// Measures TypeTable lookup cost for growing numbers of mappings. The cost
+// per lookup should stay roughly flat from tens to hundreds of thousands of
+// entries (it only grows once the table no longer fits in cache).
+//
+//   make benchmark && ./type_table_benchmark
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../source/type_table.hpp"
+
+static std::string domain_type_name(std::size_t i) {
+  return "DomainType" + std::to_string(i * 7919 % 1000003) + "Record";
+}
+
+int main() {
+  const std::size_t LOOKUPS = 2000000;
+  std::printf("%10s %14s %14s\n", "mappings", "hit ns/lookup",
+              "miss ns/lookup");
+
+  for (std::size_t count = 16; count <= 262144; count *= 4) {
+    TypeTable table;
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < count; i++) {
+      names.push_back(domain_type_name(i));
+      table.add(names.back(), {"acme::" + names.back(), "", true, 0, 0});
+    }
+
+    std::vector<std::string> queries, misses;
+    std::mt19937 random(42);
+    std::uniform_int_distribution<std::size_t> pick(0, count - 1);
+    for (std::size_t i = 0; i < 4096; i++) {
+      queries.push_back(names[pick(random)]);
+      misses.push_back("Unmapped" + names[pick(random)]);
+    }
+
+    auto time_lookups = [&](const std::vector<std::string> &keys) {
+      std::size_t found = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (std::size_t i = 0; i < LOOKUPS; i++) {
+        found += table.contains(keys[i & (keys.size() - 1)]);
+      }
+      std::chrono::duration<double, std::nano> elapsed =
+          std::chrono::steady_clock::now() - start;
+      if (found == SIZE_MAX)
+        std::puts(""); // Keeps the loop from being optimised away
+      return elapsed.count() / LOOKUPS;
+    };
+
+    double hit = time_lookups(queries);
+    double miss = time_lookups(misses);
+    std::printf("%10zu %14.1f %14.1f\n", table.size(), hit, miss);
+  }
+  return 0;
+}
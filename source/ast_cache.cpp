@@ -0,0 +1,54 @@
+#include "ast_cache.hpp"
+#include "hash_utils.hpp"
+
+AstCache::AstCache(std::size_t capacity) : capacity(capacity ? capacity : 1) {}
+
+// The length keeps "ab" + "c" and "a" + "bc" apart
+static std::uint64_t entry_key(std::string_view source,
+                               const std::string &type_map_identity) {
+  std::uint64_t seed = HashUtils::fnv1a_64(
+      std::to_string(type_map_identity.size()) + ":" + type_map_identity);
+  return HashUtils::fnv1a_64(source, seed);
+}
+
+AstCache::ClassNodes AstCache::find(std::string_view source,
+                                    const std::string &type_map_identity) {
+  auto entry = entries.find(entry_key(source, type_map_identity));
+  // A hash collision is a miss, never the AST of another input
+  if (entry == entries.end() || entry->second->source != source ||
+      entry->second->type_map_identity != type_map_identity) {
+    miss_count++;
+    return nullptr;
+  }
+  hit_count++;
+  recent.splice(recent.begin(), recent, entry->second);
+  return entry->second->class_nodes;
+}
+
+void AstCache::insert(std::string_view source,
+                      const std::string &type_map_identity,
+                      ClassNodes class_nodes) {
+  std::uint64_t key = entry_key(source, type_map_identity);
+  auto entry = entries.find(key);
+  if (entry != entries.end()) {
+    // Same input again, or one colliding with it that takes its place
+    entry->second->source = std::string(source);
+    entry->second->type_map_identity = type_map_identity;
+    entry->second->class_nodes = std::move(class_nodes);
+    recent.splice(recent.begin(), recent, entry->second);
+    return;
+  }
+  if (entries.size() == capacity) {
+    entries.erase(recent.back().key);
+    recent.pop_back();
+  }
+  recent.push_front(Entry{key, std::string(source), type_map_identity,
+                          std::move(class_nodes)});
+  entries.emplace(key, recent.begin());
+}
+
+std::size_t AstCache::size() const { return entries.size(); }
+
+std::size_t AstCache::hits() const { return hit_count; }
+
+std::size_t AstCache::misses() const { return miss_count; }
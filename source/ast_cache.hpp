@@ -0,0 +1,55 @@
+#ifndef AST_CACHE
+#define AST_CACHE
+
+#include "parser.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Entries kept by a default AstCache
+#define AST_CACHE_CAPACITY 256
+
+// Validated class nodes of recently converted inputs, so that a long-lived
+// process converting the same source again skips lexing, parsing and
+// validation. Entries are found by a hash of the source text and the type
+// mappings it was validated against, and only returned when both compare
+// equal to the stored ones; the least recently used entry is evicted first.
+class AstCache {
+public:
+  using ClassNodes = std::shared_ptr<const std::vector<ClassNode>>;
+
+  explicit AstCache(std::size_t capacity = AST_CACHE_CAPACITY);
+
+  // type_map_identity names the installed type mappings, empty for the
+  // built-in ones. nullptr when absent.
+  ClassNodes find(std::string_view source,
+                  const std::string &type_map_identity);
+  void insert(std::string_view source, const std::string &type_map_identity,
+              ClassNodes class_nodes);
+
+  std::size_t size() const;
+  std::size_t hits() const;
+  std::size_t misses() const;
+
+private:
+  struct Entry {
+    std::uint64_t key;
+    std::string source;
+    std::string type_map_identity;
+    ClassNodes class_nodes;
+  };
+
+  std::size_t capacity;
+  // Most recently used first
+  std::list<Entry> recent;
+  std::unordered_map<std::uint64_t, decltype(recent)::iterator> entries;
+  std::size_t hit_count = 0;
+  std::size_t miss_count = 0;
+};
+
+#endif
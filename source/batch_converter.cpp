@@ -0,0 +1,234 @@
+#include "batch_converter.hpp"
+#include "converter.hpp"
+#include "field_layout.hpp"
+#include "file_handler.hpp"
+#include "generation_stage.hpp"
+#include "output_directory.hpp"
+#include "output_manifest.hpp"
+#include "parser.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include "unity_builder.hpp"
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+BatchPlan BatchConverter::plan(const std::vector<std::string> &input_paths,
+                               const std::string &output_root) {
+  TraceSpan span("find inputs");
+  BatchPlan plan;
+  std::unordered_map<std::string, std::string> input_by_output;
+
+  auto add = [&](const fs::path &file, const fs::path &relative,
+                 std::uintmax_t size) {
+    fs::path output = fs::path(output_root) / relative;
+    output.replace_extension();
+    std::string output_directory = output.lexically_normal().string();
+
+    auto [owner, inserted] =
+        input_by_output.emplace(output_directory, file.string());
+    if (!inserted) {
+      plan.failures.push_back(
+          BatchFailure{file.string(), "output directory '" + output_directory +
+                                          "' is already used by " +
+                                          owner->second});
+      return;
+    }
+    plan.inputs.push_back(BatchInput{file.string(), output_directory, size});
+  };
+
+  for (const std::string &input_path : input_paths) {
+    fs::path path(input_path);
+    std::error_code error;
+    fs::file_status status = fs::status(path, error);
+    if (error || !fs::exists(status)) {
+      plan.failures.push_back(BatchFailure{input_path, "does not exist"});
+      continue;
+    }
+    if (!fs::is_directory(status)) {
+      std::uintmax_t size = fs::file_size(path, error);
+      add(path, path.filename(), error ? 0 : size);
+      continue;
+    }
+
+    // Sorted so that the output layout does not depend on readdir order
+    std::vector<fs::path> files;
+    for (fs::recursive_directory_iterator
+             it(path, fs::directory_options::skip_permission_denied, error),
+         end;
+         !error && it != end; it.increment(error)) {
+      std::error_code type_error;
+      if (it->path().extension() == ".cs" && it->is_regular_file(type_error)) {
+        files.push_back(it->path());
+      }
+    }
+    if (error) {
+      plan.failures.push_back(
+          BatchFailure{input_path, "cannot be listed: " + error.message()});
+    }
+    std::sort(files.begin(), files.end());
+    for (const fs::path &file : files) {
+      std::uintmax_t size = fs::file_size(file, error);
+      add(file, file.lexically_relative(path), error ? 0 : size);
+    }
+  }
+  return plan;
+}
+
+BatchResult BatchConverter::convert_all(const BatchPlan &plan,
+                                        const ProgramOptions &options,
+                                        WorkStealingPool &pool,
+                                        ResultCache *cache) {
+  // Largest first, so that no big file starts last and stretches the batch
+  std::vector<const BatchInput *> order;
+  for (const BatchInput &input : plan.inputs) {
+    order.push_back(&input);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [](const BatchInput *a, const BatchInput *b) {
+                     return a->size > b->size;
+                   });
+
+  struct Outcome {
+    FileConversion conversion;
+    bool failed = false;
+    std::string message;
+  };
+  std::vector<Outcome> outcomes(order.size());
+  // One file system sync before and one after the renames of the whole run
+  DeferredCommit deferred;
+  std::vector<std::function<void()>> tasks;
+  for (std::size_t i = 0; i < order.size(); i++) {
+    tasks.push_back([&, i]() {
+      try {
+        outcomes[i].conversion =
+            convert_file(*order[i], options, cache, &deferred);
+      } catch (const std::exception &e) {
+        outcomes[i].failed = true;
+        outcomes[i].message = e.what();
+      }
+    });
+  }
+  pool.run(std::move(tasks));
+  deferred.commit();
+
+  BatchResult result;
+  result.failures = plan.failures;
+  // Back in plan order, so that the depfile does not depend on sizes
+  std::vector<const Outcome *> plan_outcomes(plan.inputs.size());
+  for (std::size_t i = 0; i < order.size(); i++) {
+    plan_outcomes[order[i] - plan.inputs.data()] = &outcomes[i];
+  }
+  for (std::size_t i = 0; i < plan.inputs.size(); i++) {
+    if (!plan_outcomes[i]->failed) {
+      result.outputs.push_back(
+          BatchOutput{plan.inputs[i].output_directory,
+                      plan_outcomes[i]->conversion.manifest});
+    }
+  }
+  for (std::size_t i = 0; i < order.size(); i++) {
+    const Outcome &outcome = outcomes[i];
+    if (outcome.failed) {
+      result.failures.push_back(BatchFailure{order[i]->path, outcome.message});
+      continue;
+    }
+    result.converted_files++;
+    result.classes += outcome.conversion.classes;
+    result.members += outcome.conversion.members;
+    result.files_written += outcome.conversion.files_written;
+    result.files_unchanged += outcome.conversion.files_unchanged;
+    result.bytes_written += outcome.conversion.bytes_written;
+    result.stale_files_removed += outcome.conversion.stale_files_removed;
+    result.restored_files += outcome.conversion.restored;
+  }
+  std::stable_sort(result.failures.begin(), result.failures.end(),
+                   [](const BatchFailure &a, const BatchFailure &b) {
+                     return a.path < b.path;
+                   });
+  return result;
+}
+
+FileConversion BatchConverter::convert_file(const BatchInput &input,
+                                            const ProgramOptions &options,
+                                            ResultCache *cache,
+                                            DeferredCommit *deferred) {
+  TraceSpan span("convert", "file", input.path);
+  InputFile source = FileHandler::read_input_file(input.path);
+  FileConversion conversion;
+  std::string cache_key;
+  if (cache) {
+    cache_key = cache->key(source.view());
+    OutputDirectory output(input.output_directory, options.durability);
+    CachedConversion cached;
+    if (cache->restore(cache_key, source.view(), output, cached)) {
+      conversion.restored = true;
+      conversion.classes = cached.classes;
+      conversion.members = cached.members;
+      finish(input, options, output, deferred, conversion);
+      return conversion;
+    }
+  }
+
+  std::vector<ClassNode> class_nodes = Converter::parse(source.view());
+  OutputDirectory output(input.output_directory, options.durability);
+
+  // Files are the unit of parallelism, classes are generated in place
+  if (options.unity_units) {
+    GeneratorOptions generator = options.generator;
+    ClassLayouts packed_layouts;
+    if (generator.pack_fields) {
+      packed_layouts = FieldLayout::compute_class_layouts(class_nodes, true);
+      generator.class_layouts = &packed_layouts;
+    }
+    ThreadPool inline_pool(0);
+    UnityBuilder::write(UnityBuilder::build(class_nodes, options.unity_units,
+                                            generator, inline_pool),
+                        output);
+    if (generator.hash_support) {
+      GenerationStage::write_hash_check(class_nodes, {UNITY_HEADER_NAME},
+                                        output);
+    }
+  } else {
+    ConvertedSource generated =
+        Converter::generate(class_nodes, ConverterOptions{options.generator});
+    for (const GeneratedClass &generated_class : generated.classes) {
+      GenerationStage::write_class(generated_class, output);
+    }
+    if (options.generator.hash_support) {
+      output.write_if_changed(HASH_CHECK_FILE_NAME, generated.hash_check);
+    }
+  }
+  CachedConversion converted = ResultCache::describe(class_nodes);
+  conversion.classes = converted.classes;
+  conversion.members = converted.members;
+  finish(input, options, output, deferred, conversion);
+  if (cache) {
+    cache->store(cache_key, source.view(), output, converted);
+  }
+  return conversion;
+}
+
+void BatchConverter::finish(const BatchInput &input,
+                            const ProgramOptions &options,
+                            OutputDirectory &output,
+                            DeferredCommit *deferred,
+                            FileConversion &conversion) {
+  ManifestUpdate manifest =
+      ManifestFile::update(output, ManifestFile::inputs(input.path, options));
+  if (deferred) {
+    output.commit(*deferred);
+  } else {
+    output.commit();
+  }
+
+  conversion.manifest = std::move(manifest.manifest);
+  conversion.stale_files_removed = manifest.stale_files.size();
+  OutputDirectoryStats stats = output.stats();
+  conversion.files_written = stats.files_written;
+  conversion.files_unchanged = stats.files_unchanged;
+  conversion.bytes_written = stats.bytes_written;
+}
@@ -0,0 +1,95 @@
+#ifndef BATCH_CONVERTER
+#define BATCH_CONVERTER
+
+#include "options.hpp"
+#include "output_directory.hpp"
+#include "output_manifest.hpp"
+#include "result_cache.hpp"
+#include "work_stealing_pool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One .cs file to convert and where its classes are written
+struct BatchInput {
+  std::string path;
+  std::string output_directory;
+  std::uintmax_t size = 0;
+};
+
+struct BatchFailure {
+  std::string path;
+  std::string message;
+};
+
+// Inputs found under the command line paths. Paths that cannot be used
+// are failures of their own and do not stop the others.
+struct BatchPlan {
+  std::vector<BatchInput> inputs;
+  std::vector<BatchFailure> failures;
+};
+
+struct FileConversion {
+  std::size_t classes = 0;
+  std::size_t members = 0; // Fields, methods and properties
+  std::size_t files_written = 0;
+  std::size_t files_unchanged = 0;
+  std::uint64_t bytes_written = 0;
+  OutputManifest manifest;
+  std::size_t stale_files_removed = 0;
+  bool restored = false; // From the result cache
+};
+
+// Where a converted file was written and what its manifest lists
+struct BatchOutput {
+  std::string output_directory;
+  OutputManifest manifest;
+};
+
+struct BatchResult {
+  std::size_t converted_files = 0;
+  std::size_t classes = 0;
+  std::size_t members = 0;
+  std::size_t files_written = 0;
+  std::size_t files_unchanged = 0;
+  std::uint64_t bytes_written = 0;
+  std::size_t stale_files_removed = 0;
+  std::size_t restored_files = 0; // Inputs found in the result cache
+  std::vector<BatchOutput> outputs;   // In input order
+  std::vector<BatchFailure> failures; // Sorted by path
+};
+
+// Converts many .cs files in one process. Every file is parsed, validated
+// and generated by a single pool worker; the largest files are scheduled
+// first and a failing file never affects the others.
+class BatchConverter {
+public:
+  // Files are written to <output_root>/<stem>, files found in a directory
+  // to <output_root>/<path relative to it, without .cs>
+  static BatchPlan plan(const std::vector<std::string> &input_paths,
+                        const std::string &output_root);
+
+  // Without a cache, every file is converted. With Durability::Batched the
+  // outputs of all files are made durable together once all were converted;
+  // throws IO_Exception when that fails.
+  static BatchResult convert_all(const BatchPlan &plan,
+                                 const ProgramOptions &options,
+                                 WorkStealingPool &pool,
+                                 ResultCache *cache = nullptr);
+
+  // Throws the exception of the first stage that fails. The output is
+  // committed into deferred when given, right away otherwise.
+  static FileConversion convert_file(const BatchInput &input,
+                                     const ProgramOptions &options,
+                                     ResultCache *cache = nullptr,
+                                     DeferredCommit *deferred = nullptr);
+
+private:
+  // Manifest, commit and counts, whether converted or restored
+  static void finish(const BatchInput &input, const ProgramOptions &options,
+                     OutputDirectory &output, DeferredCommit *deferred,
+                     FileConversion &conversion);
+};
+
+#endif
@@ -0,0 +1,198 @@
+#include "bundle.hpp"
+#include "custom_exceptions.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace {
+
+// Field offsets and widths of a ustar header block
+constexpr std::size_t NAME_OFFSET = 0, NAME_SIZE = 100;
+constexpr std::size_t MODE_OFFSET = 100;
+constexpr std::size_t UID_OFFSET = 108;
+constexpr std::size_t GID_OFFSET = 116;
+constexpr std::size_t SIZE_OFFSET = 124, SIZE_SIZE = 12;
+constexpr std::size_t MTIME_OFFSET = 136;
+constexpr std::size_t CHECKSUM_OFFSET = 148, CHECKSUM_SIZE = 8;
+constexpr std::size_t TYPE_OFFSET = 156;
+constexpr std::size_t MAGIC_OFFSET = 257;
+constexpr std::size_t PREFIX_OFFSET = 345, PREFIX_SIZE = 155;
+
+using HeaderBlock = std::array<char, BUNDLE_BLOCK_SIZE>;
+
+// Zero-padded octal digits followed by a NUL, as tar expects
+void put_octal(HeaderBlock &header, std::size_t offset, std::size_t width,
+               std::uint64_t value) {
+  for (std::size_t i = width - 1; i-- > 0; value >>= 3) {
+    header[offset + i] = static_cast<char>('0' + (value & 7));
+  }
+  if (value != 0) {
+    throw IO_Exception("Bundle entry is too large for a tar header");
+  }
+}
+
+void put_string(HeaderBlock &header, std::size_t offset,
+                const std::string &value) {
+  std::memcpy(header.data() + offset, value.data(), value.size());
+}
+
+std::uint64_t header_checksum(const char *header) {
+  std::uint64_t sum = 0;
+  for (std::size_t i = 0; i < BUNDLE_BLOCK_SIZE; i++) {
+    bool in_checksum =
+        i >= CHECKSUM_OFFSET && i < CHECKSUM_OFFSET + CHECKSUM_SIZE;
+    sum += in_checksum ? ' ' : static_cast<unsigned char>(header[i]);
+  }
+  return sum;
+}
+
+std::uint64_t parse_octal(const char *field, std::size_t width) {
+  std::uint64_t value = 0;
+  std::size_t i = 0;
+  while (i < width && field[i] == ' ')
+    i++;
+  for (; i < width && field[i] >= '0' && field[i] <= '7'; i++) {
+    value = value * 8 + static_cast<std::uint64_t>(field[i] - '0');
+  }
+  return value;
+}
+
+std::string parse_string(const char *field, std::size_t width) {
+  return std::string(field, strnlen(field, width));
+}
+
+std::size_t padded_size(std::uint64_t size) {
+  return static_cast<std::size_t>((size + BUNDLE_BLOCK_SIZE - 1) /
+                                  BUNDLE_BLOCK_SIZE * BUNDLE_BLOCK_SIZE);
+}
+
+IO_Exception corrupt_bundle(const std::string &reason) {
+  return IO_Exception(("Corrupt bundle: " + reason).c_str());
+}
+
+} // namespace
+
+BundleWriter::BundleWriter(std::ostream &output) : output(output) {}
+
+void BundleWriter::add(const std::string &name, std::string_view content) {
+  if (name.empty()) {
+    throw IO_Exception("Bundle entries need a file name");
+  }
+
+  // Names over 100 characters are split into prefix and name at a '/'
+  std::string prefix, short_name = name;
+  if (name.size() > NAME_SIZE) {
+    std::size_t split = name.rfind('/', PREFIX_SIZE);
+    if (split == std::string::npos || split == 0 ||
+        name.size() - split - 1 > NAME_SIZE || split + 1 == name.size()) {
+      throw IO_Exception(
+          ("File name too long for a bundle entry: " + name).c_str());
+    }
+    prefix = name.substr(0, split);
+    short_name = name.substr(split + 1);
+  }
+
+  HeaderBlock header{};
+
+  put_string(header, NAME_OFFSET, short_name);
+  put_octal(header, MODE_OFFSET, 8, 0644);
+  put_octal(header, UID_OFFSET, 8, 0);
+  put_octal(header, GID_OFFSET, 8, 0);
+  put_octal(header, SIZE_OFFSET, SIZE_SIZE, content.size());
+  put_octal(header, MTIME_OFFSET, 12, 0);
+  header[TYPE_OFFSET] = '0';
+  put_string(header, MAGIC_OFFSET, std::string("ustar\0" "00", 8));
+  put_string(header, PREFIX_OFFSET, prefix);
+
+  // Six octal digits, NUL, space
+  put_octal(header, CHECKSUM_OFFSET, 7, header_checksum(header.data()));
+  header[CHECKSUM_OFFSET + 7] = ' ';
+
+  write(header.data(), header.size());
+  write(content.data(), content.size());
+  pad_to_block(content.size());
+  entries++;
+}
+
+void BundleWriter::finish() {
+  static const HeaderBlock zero_block{};
+  write(zero_block.data(), zero_block.size());
+  write(zero_block.data(), zero_block.size());
+  output.flush();
+  if (output.fail()) {
+    throw IO_Exception("Failed while writing the bundle");
+  }
+}
+
+std::size_t BundleWriter::entry_count() const { return entries; }
+
+std::uint64_t BundleWriter::bytes_written() const { return bytes; }
+
+void BundleWriter::write(const char *data, std::size_t size) {
+  output.write(data, static_cast<std::streamsize>(size));
+  if (output.fail()) {
+    throw IO_Exception("Failed while writing the bundle");
+  }
+  bytes += size;
+}
+
+void BundleWriter::pad_to_block(std::size_t size) {
+  static const HeaderBlock zero_block{};
+  write(zero_block.data(), padded_size(size) - size);
+}
+
+BundleReader::BundleReader(std::string_view data) {
+  std::size_t position = 0;
+  while (true) {
+    if (data.size() - position < BUNDLE_BLOCK_SIZE) {
+      throw corrupt_bundle("missing end-of-archive marker");
+    }
+    const char *header = data.data() + position;
+    if (std::all_of(header, header + BUNDLE_BLOCK_SIZE,
+                    [](char c) { return c == '\0'; })) {
+      break;
+    }
+
+    if (std::memcmp(header + MAGIC_OFFSET, "ustar", 5) != 0) {
+      throw corrupt_bundle("not a ustar header at offset " +
+                           std::to_string(position));
+    }
+    if (parse_octal(header + CHECKSUM_OFFSET, CHECKSUM_SIZE) !=
+        header_checksum(header)) {
+      throw corrupt_bundle("header checksum mismatch at offset " +
+                           std::to_string(position));
+    }
+
+    std::uint64_t size = parse_octal(header + SIZE_OFFSET, SIZE_SIZE);
+    position += BUNDLE_BLOCK_SIZE;
+    if (size > data.size() - position ||
+        padded_size(size) > data.size() - position) {
+      throw corrupt_bundle("entry content runs past the end of the data");
+    }
+
+    // Directories, links and extended headers carry no generated file
+    char type = header[TYPE_OFFSET];
+    if (type == '0' || type == '\0') {
+      std::string name = parse_string(header + NAME_OFFSET, NAME_SIZE);
+      std::string prefix = parse_string(header + PREFIX_OFFSET, PREFIX_SIZE);
+      if (!prefix.empty()) {
+        name = prefix + "/" + name;
+      }
+      // Like tar, a later entry with the same name wins
+      index_by_name[name] = entry_list.size();
+      entry_list.push_back(
+          BundleEntry{std::move(name),
+                      data.substr(position, static_cast<std::size_t>(size))});
+    }
+    position += padded_size(size);
+  }
+}
+
+const std::vector<BundleEntry> &BundleReader::entries() const {
+  return entry_list;
+}
+
+const BundleEntry *BundleReader::find(const std::string &name) const {
+  auto it = index_by_name.find(name);
+  return it == index_by_name.end() ? nullptr : &entry_list[it->second];
+}
@@ -0,0 +1,61 @@
+#ifndef BUNDLE
+#define BUNDLE
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Bundles are POSIX ustar archives: every generated file is one regular
+// file entry, written sequentially, so `tar -xf` extracts them as well.
+// Timestamps, owners and modes are fixed, so the same output always yields
+// byte-identical bundles.
+#define BUNDLE_BLOCK_SIZE 512
+
+// A file stored in a bundle. The content points into the bundle data.
+struct BundleEntry {
+  std::string name;
+  std::string_view content;
+};
+
+// Appends files to a bundle stream. finish() must be called once all files
+// are added; it writes the end-of-archive marker and flushes the stream.
+class BundleWriter {
+public:
+  explicit BundleWriter(std::ostream &output);
+
+  void add(const std::string &name, std::string_view content);
+  void finish();
+
+  std::size_t entry_count() const;
+  std::uint64_t bytes_written() const;
+
+private:
+  std::ostream &output;
+  std::size_t entries = 0;
+  std::uint64_t bytes = 0;
+
+  void write(const char *data, std::size_t size);
+  void pad_to_block(std::size_t size);
+};
+
+// Index over bundle data (e.g. an InputFile view) without copying the file
+// contents; the data must outlive the reader. Throws IO_Exception when the
+// data is not a valid bundle.
+class BundleReader {
+public:
+  explicit BundleReader(std::string_view data);
+
+  // In the order they were written
+  const std::vector<BundleEntry> &entries() const;
+  const BundleEntry *find(const std::string &name) const;
+
+private:
+  std::vector<BundleEntry> entry_list;
+  std::unordered_map<std::string, std::size_t> index_by_name;
+};
+
+#endif
@@ -1,31 +1,100 @@
 #include "code_generator.hpp"
+#include "name_transformer.hpp"
+#include "type_table.hpp"
+#include <algorithm>
+#include <array>
 #include <sstream>
-#include <unordered_map>
 
 #define METHOD_COMMENT "//TODO: implement this method"
 
+// Access blocks are stored in a fixed array indexed by the AccessModifier
+// value and always printed in this order, so the generated headers are
+// byte-identical regardless of the standard library in use.
+static constexpr std::size_t ACCESS_MODIFIER_COUNT = 3;
+static constexpr std::array<AccessModifier, ACCESS_MODIFIER_COUNT>
+    ACCESS_BLOCK_ORDER = {AccessModifier::Private, AccessModifier::Protected,
+                          AccessModifier::Public};
+
 // Writes the class info into the header file
 void CodeGenerator::generate_header(const ClassNode &class_node,
                                     std::ostream &of) {
+  generate_header(class_node, of, GeneratorOptions{});
+}
+
+void CodeGenerator::generate_header(const ClassNode &class_node,
+                                    std::ostream &of,
+                                    const GeneratorOptions &options) {
+  of << "#pragma once\n";
+  for (const std::string &header :
+       required_standard_headers(class_node, options)) {
+    of << "#include " << header << "\n";
+  }
+  for (const std::string &type : complete_type_dependencies(class_node)) {
+    of << "#include \"" << type << ".hpp\"\n";
+  }
+  of << "\n";
+
+  std::set<std::string> forward_declarations =
+      forward_declared_types(class_node);
+  for (const std::string &type : forward_declarations) {
+    of << "class " << type << ";\n";
+  }
+  if (!forward_declarations.empty()) {
+    of << "\n";
+  }
+
+  generate_class_declaration(class_node, of, options);
+}
+
+void CodeGenerator::generate_class_declaration(const ClassNode &class_node,
+                                               std::ostream &of) {
+  generate_class_declaration(class_node, of, GeneratorOptions{});
+}
+
+void CodeGenerator::generate_class_declaration(
+    const ClassNode &class_node, std::ostream &of,
+    const GeneratorOptions &options) {
   of << "class " << class_node.name;
   if (class_node.base_class) {
     of << " : public " << *class_node.base_class;
   }
   of << " {\n";
 
-  // Generate the contents for the public:, private:, protected: blocks
-  std::unordered_map<AccessModifier, std::vector<std::string>> blocks;
+  // Generate the contents for the public:, private:, protected: blocks.
+  // Members keep their declaration order inside each block.
+  std::array<std::vector<std::string>, ACCESS_MODIFIER_COUNT> storage;
+  auto blocks =
+      [&storage](AccessModifier access) -> std::vector<std::string> & {
+    return storage[static_cast<std::size_t>(access)];
+  };
+
+  // Line positions of the data members of each block, so a packed layout can
+  // reorder them without moving any other declaration
+  std::array<std::vector<std::pair<std::size_t, FieldNode>>,
+             ACCESS_MODIFIER_COUNT>
+      field_slots;
+  auto add_field = [&](AccessModifier access, const FieldNode &field) {
+    std::vector<std::string> &lines = blocks(access);
+    field_slots[static_cast<std::size_t>(access)].push_back(
+        {lines.size(), field});
+    lines.push_back(generate_field(field));
+  };
 
   // Public: Constructor
-  blocks[AccessModifier::Public].push_back(
+  blocks(AccessModifier::Public).push_back(
       generate_constructor_declaration(class_node.name));
+  if (options.signature_policy == SignaturePolicy::Performance) {
+    for (std::string &declaration :
+         generate_copy_and_move_declarations(class_node.name)) {
+      blocks(AccessModifier::Public).push_back(std::move(declaration));
+    }
+  }
 
   // Fields - Go into each block according to C# structure.
   for (const FieldNode &field : class_node.fields) {
-    blocks[field.access.value_or(AccessModifier::Private)].push_back(
-        generate_field(
-            field)); // if access is defined go into that access block, if no
-                     // access is defined go into private block by default
+    add_field(field.access.value_or(AccessModifier::Private),
+              field); // if access is defined go into that access block, if no
+                      // access is defined go into private block by default
   }
 
   /*
@@ -40,31 +109,51 @@ void CodeGenerator::generate_header(const ClassNode &class_node,
          prop.access.value() == AccessModifier::Public) ||
         !prop.access.has_value()) {
       FieldNode prop_field_node{AccessModifier::Public, prop.type, prop.name};
-      blocks[AccessModifier::Private].push_back(
-          generate_field(prop_field_node));
-      blocks[AccessModifier::Public].push_back(
-          generate_property_declarations(prop));
+      add_field(AccessModifier::Private, prop_field_node);
+      blocks(AccessModifier::Public).push_back(
+          generate_property_declarations(prop, options));
     } else {
-      blocks[prop.access.value()].push_back(
-          generate_field(FieldNode{prop.access.value(), prop.type, prop.name}));
-      blocks[prop.access.value()].push_back(
-          generate_property_declarations(prop));
+      add_field(prop.access.value(),
+                FieldNode{prop.access.value(), prop.type, prop.name});
+      blocks(prop.access.value()).push_back(
+          generate_property_declarations(prop, options));
     }
   }
 
   for (const auto &method : class_node.methods) {
     if(method.name != class_node.name){
-      blocks[method.access.value_or(AccessModifier::Private)].push_back(
-          generate_method_declaration(method, class_node.name));
+      blocks(method.access.value_or(AccessModifier::Private)).push_back(
+          generate_method_declaration(method, class_node.name, options));
+    }
+  }
+
+  if (options.hash_support) {
+    if (!has_equals_method(class_node)) {
+      blocks(AccessModifier::Public).push_back(
+          generate_equals_declaration(class_node.name, options));
     }
+    blocks(AccessModifier::Public).push_back(
+        "std::size_t hash_value() const noexcept;");
   }
 
   // Public: Destructor
-  blocks[AccessModifier::Public].push_back(
+  blocks(AccessModifier::Public).push_back(
       generate_destructor_declaration(class_node.name));
 
-  // "Print" according to the access modifier blocks
-  for (const auto &[access, lines] : blocks) {
+  if (options.pack_fields) {
+    std::vector<DataMember> packed = emitted_data_members(class_node, options);
+    for (std::size_t i = 0; i < ACCESS_MODIFIER_COUNT; i++) {
+      pack_field_lines(storage[i], field_slots[i],
+                       static_cast<AccessModifier>(i), packed);
+    }
+  }
+
+  // "Print" according to the access modifier blocks, skipping empty ones
+  for (AccessModifier access : ACCESS_BLOCK_ORDER) {
+    const std::vector<std::string> &lines = blocks(access);
+    if (lines.empty()) {
+      continue;
+    }
     of << generate_modifier_string(access) << ":\n";
     for (const auto &line : lines) {
       of << "    " << line << "\n";
@@ -72,10 +161,31 @@ void CodeGenerator::generate_header(const ClassNode &class_node,
   }
 
   of << "};\n";
+
+  if (options.hash_support) {
+    of << generate_hash_specialization(class_node.name);
+  }
 }
 
 // Header file Auxiliary Functions
 
+// Refills the data member lines of a block in the order of the packed
+// members of that block, as returned by FieldLayout::pack_members. Anything
+// that follows the member order (like memberwise operations) must use the
+// same order.
+void CodeGenerator::pack_field_lines(
+    std::vector<std::string> &lines,
+    const std::vector<std::pair<std::size_t, FieldNode>> &slots,
+    AccessModifier access, const std::vector<DataMember> &packed) {
+  std::size_t slot = 0;
+  for (const DataMember &member : packed) {
+    if (member.access == access && slot < slots.size()) {
+      lines[slots[slot++].first] =
+          generate_field(FieldNode{access, member.type, member.name});
+    }
+  }
+}
+
 std::string
 CodeGenerator::generate_constructor_declaration(const std::string &class_name) {
   return class_name + "();";
@@ -86,6 +196,17 @@ CodeGenerator::generate_destructor_declaration(const std::string &class_name) {
   return "~" + generate_constructor_declaration(class_name);
 }
 
+// The declared destructor suppresses the implicit move operations, so they
+// are defaulted explicitly (with copies, which declaring a move would delete)
+std::vector<std::string> CodeGenerator::generate_copy_and_move_declarations(
+    const std::string &class_name) {
+  return {class_name + "(const " + class_name + "& other) = default;",
+          class_name + "(" + class_name + "&& other) = default;",
+          class_name + "& operator=(const " + class_name +
+              "& other) = default;",
+          class_name + "& operator=(" + class_name + "&& other) = default;"};
+}
+
 std::string CodeGenerator::generate_field(const FieldNode &field) {
   return format_type(field.type) + " " + trasform_pascal_case_name(field.name) +
          ";";
@@ -93,10 +214,11 @@ std::string CodeGenerator::generate_field(const FieldNode &field) {
 
 std::string
 CodeGenerator::generate_method_declaration(const MethodNode &method,
-                                           const std::string &class_name) {
+                                           const std::string &class_name,
+                                           const GeneratorOptions &options) {
   // EXTRA: Add more special functions
   if (method.name == "Equals") {
-    return generate_equals_declaration(class_name);
+    return generate_equals_declaration(class_name, options);
   } else {
 
     std::ostringstream oss;
@@ -107,23 +229,29 @@ CodeGenerator::generate_method_declaration(const MethodNode &method,
       oss << "void";
     }
 
-    oss << " " << trasform_pascal_case_name(method.name) << "(" << generate_param_list(method.parameters)
-        << ");";
+    oss << " " << trasform_pascal_case_name(method.name) << "("
+        << generate_param_list(method.parameters, options) << ");";
 
     return oss.str();
   }
 }
 
 std::string
-CodeGenerator::generate_equals_declaration(const std::string &class_name) {
+CodeGenerator::generate_equals_declaration(const std::string &class_name,
+                                           const GeneratorOptions &options) {
+  if (is_equals_const(options)) {
+    return "bool operator==(const " + class_name + "& other) const;";
+  }
   return "bool operator==(const " + class_name + "& other);";
 }
 
 std::string
-CodeGenerator::generate_param_list(const std::vector<MethodParam> &params) {
+CodeGenerator::generate_param_list(const std::vector<MethodParam> &params,
+                                   const GeneratorOptions &options) {
   std::ostringstream oss;
   for (size_t i = 0; i < params.size(); i++) {
-    oss << format_type(params[i].type) << " " << params[i].name;
+    oss << generate_param_type(params[i].type, options) << " "
+        << params[i].name;
     if (i + 1 < params.size())
       oss << ", ";
   }
@@ -131,7 +259,18 @@ CodeGenerator::generate_param_list(const std::vector<MethodParam> &params) {
 }
 
 std::string
-CodeGenerator::generate_property_declarations(const PropertyNode &property) {
+CodeGenerator::generate_param_type(const std::string &type,
+                                   const GeneratorOptions &options) {
+  if (options.signature_policy == SignaturePolicy::Performance &&
+      is_passed_by_reference(type)) {
+    return "const " + format_type(type) + "&";
+  }
+  return format_type(type);
+}
+
+std::string
+CodeGenerator::generate_property_declarations(const PropertyNode &property,
+                                              const GeneratorOptions &options) {
   std::ostringstream oss;
 
   int count = 0;
@@ -139,12 +278,17 @@ CodeGenerator::generate_property_declarations(const PropertyNode &property) {
     if (count) {
       oss << "\n    ";
     }
+    // Auto-property accessors are defined inline so callers can inline them,
+    // accessors with a body keep an out-of-line definition in the source
+    std::string ending = accessor.has_brackets
+                             ? ";"
+                             : " " + generate_inline_accessor_body(
+                                         property, accessor, options);
     if (accessor.operation == "get") {
-      oss << format_type(property.type) << " get_"
-          << trasform_pascal_case_name(property.name) << "();";
+      oss << generate_getter_signature(property, accessor, "", options)
+          << ending;
     } else if (accessor.operation == "set") {
-      oss << "void set_" << trasform_pascal_case_name(property.name) << "("
-          << format_type(property.type) << " value);";
+      oss << generate_setter_signature(property, "") << ending;
     }
     count++;
   }
@@ -152,28 +296,100 @@ CodeGenerator::generate_property_declarations(const PropertyNode &property) {
   return oss.str();
 }
 
+// Getter signature, scope is empty for declarations and "Class::" for
+// definitions. Under the performance policy non-trivial types are returned
+// by const reference to the backing field, and auto-property getters, which
+// only read that field, are noexcept.
+std::string
+CodeGenerator::generate_getter_signature(const PropertyNode &property,
+                                         const PropertyAcessor &accessor,
+                                         const std::string &scope,
+                                         const GeneratorOptions &options) {
+  std::string name = scope + "get_" + trasform_pascal_case_name(property.name);
+  if (options.signature_policy != SignaturePolicy::Performance) {
+    return format_type(property.type) + " " + name + "()";
+  }
+  return generate_param_type(property.type, options) + " " + name +
+         "() const" + (accessor.has_brackets ? "" : " noexcept");
+}
+
+// Body of an auto-property accessor, reading or assigning the backing field
+std::string
+CodeGenerator::generate_inline_accessor_body(const PropertyNode &property,
+                                             const PropertyAcessor &accessor,
+                                             const GeneratorOptions &options) {
+  std::string field = trasform_pascal_case_name(property.name);
+  if (accessor.operation == "get") {
+    return "{ return " + field + "; }";
+  }
+  return "{ " + field + " = " +
+         (moves_into_setter(property, options) ? "std::move(value)" : "value") +
+         "; }";
+}
+
+bool CodeGenerator::moves_into_setter(const PropertyNode &property,
+                                      const GeneratorOptions &options) {
+  return options.signature_policy == SignaturePolicy::Performance &&
+         is_passed_by_reference(property.type);
+}
+
+// Setters take their argument by value under every policy, so callers can
+// move into them
+std::string
+CodeGenerator::generate_setter_signature(const PropertyNode &property,
+                                         const std::string &scope) {
+  return "void " + scope + "set_" + trasform_pascal_case_name(property.name) +
+         "(" + format_type(property.type) + " value)";
+}
+
 // -----------------------------------------
 
 // Writes the class info into the source file
 void CodeGenerator::generate_source(const ClassNode &class_node,
                                     std::ostream &of) {
+  generate_source(class_node, of, GeneratorOptions{});
+}
+
+void CodeGenerator::generate_source(const ClassNode &class_node,
+                                    std::ostream &of,
+                                    const GeneratorOptions &options) {
 
   // EXTRA: These are outside project scope, but to ensure validity in case of
   // testing
   of << "#include \"" << class_node.name << ".hpp\"\n";
-  // of << "#include <iostream>\n";
-  // of << "#include <string>\n";
+  // Types only forward declared in the header are needed complete here
+  for (const std::string &type : forward_declared_types(class_node)) {
+    of << "#include \"" << type << ".hpp\"\n";
+  }
+
+  generate_source_body(class_node, of, options);
+}
+
+void CodeGenerator::generate_source_body(const ClassNode &class_node,
+                                         std::ostream &of) {
+  generate_source_body(class_node, of, GeneratorOptions{});
+}
 
+void CodeGenerator::generate_source_body(const ClassNode &class_node,
+                                         std::ostream &of,
+                                         const GeneratorOptions &options) {
   of << generate_constructor_definition(class_node.name);
 
   for (const auto &prop : class_node.properties) {
-    of << generate_property_definitions(prop, class_node.name);
+    of << generate_property_definitions(prop, class_node.name, options);
   }
 
   for (const auto &method : class_node.methods) {
     if (method.name == class_node.name)
       continue; // Constructor Already handled beforehand
-    of << generate_method_definition(method, class_node.name);
+    of << generate_method_definition(method, class_node, options);
+  }
+
+  if (options.hash_support) {
+    if (!has_equals_method(class_node)) {
+      of << generate_equals_definition(class_node, options);
+    }
+    of << generate_hash_value_definition(class_node, options);
   }
 
   of << generate_destructor_definition(class_node.name);
@@ -183,10 +399,12 @@ void CodeGenerator::generate_source(const ClassNode &class_node,
 
 std::string
 CodeGenerator::generate_method_definition(const MethodNode &method,
-                                          const std::string &class_name) {
+                                          const ClassNode &class_node,
+                                          const GeneratorOptions &options) {
+  const std::string &class_name = class_node.name;
   std::ostringstream oss;
   if (method.name == "Equals") {
-    oss << generate_equals_definition(class_name);
+    oss << generate_equals_definition(class_node, options);
   } else {
 
     if (method.return_type) {
@@ -195,8 +413,8 @@ CodeGenerator::generate_method_definition(const MethodNode &method,
       oss << "void";
     }
 
-    oss << " " << class_name << "::" << trasform_pascal_case_name(method.name) << "("
-        << generate_param_list(method.parameters) << ") {\n    "
+    oss << " " << class_name << "::" << trasform_pascal_case_name(method.name)
+        << "(" << generate_param_list(method.parameters, options) << ") {\n    "
         << METHOD_COMMENT << "\n}\n";
   }
   return oss.str();
@@ -204,19 +422,21 @@ CodeGenerator::generate_method_definition(const MethodNode &method,
 
 std::string
 CodeGenerator::generate_property_definitions(const PropertyNode &property,
-                                             const std::string &class_name) {
+                                             const std::string &class_name,
+                                             const GeneratorOptions &options) {
   std::ostringstream oss;
 
   for (const auto &accessor : property.accessors) {
+    if (!accessor.has_brackets) {
+      continue; // Defined inline in the header
+    }
     if (accessor.operation == "get") {
-      oss << format_type(property.type) << " " << class_name << "::get_"
-          << trasform_pascal_case_name(property.name) << "() {\n    "
-          << METHOD_COMMENT << "\n}\n";
+      oss << generate_getter_signature(property, accessor, class_name + "::",
+                                       options)
+          << " {\n    " << METHOD_COMMENT << "\n}\n";
     } else if (accessor.operation == "set") {
-      oss << "void " << class_name << "::set_"
-          << trasform_pascal_case_name(property.name) << "("
-          << format_type(property.type) << " value) {\n    " << METHOD_COMMENT
-          << "\n}\n";
+      oss << generate_setter_signature(property, class_name + "::")
+          << " {\n    " << METHOD_COMMENT << "\n}\n";
     }
   }
 
@@ -236,9 +456,249 @@ CodeGenerator::generate_destructor_definition(const std::string &class_name) {
 }
 
 std::string
-CodeGenerator::generate_equals_definition(const std::string &class_name) {
-  return "bool " + class_name + "::operator==(const " + class_name +
-         "& other) {\n    //TODO: implement this method\n}\n";
+CodeGenerator::generate_equals_definition(const ClassNode &class_node,
+                                          const GeneratorOptions &options) {
+  const std::string &class_name = class_node.name;
+  std::string signature = "bool " + class_name + "::operator==(const " +
+                          class_name + "& other)" +
+                          (is_equals_const(options) ? " const" : "");
+  if (!options.hash_support) {
+    return signature + " {\n    //TODO: implement this method\n}\n";
+  }
+
+  // Memberwise, over exactly the members hash_value combines
+  std::vector<std::string> terms;
+  if (class_node.base_class) {
+    terms.push_back(*class_node.base_class + "::operator==(other)");
+  }
+  for (const DataMember &member : emitted_data_members(class_node, options)) {
+    std::string name = trasform_pascal_case_name(member.name);
+    terms.push_back(name + " == other." + name);
+  }
+  if (terms.empty()) {
+    return signature + " {\n    (void)other;\n    return true;\n}\n";
+  }
+
+  std::string body = "    return ";
+  for (std::size_t i = 0; i < terms.size(); i++) {
+    body += (i ? " &&\n           " : "") + terms[i];
+  }
+  return signature + " {\n" + body + ";\n}\n";
+}
+
+// Boost-style hash_combine over the same members as operator==, so equal
+// objects always hash equally
+std::string
+CodeGenerator::generate_hash_value_definition(const ClassNode &class_node,
+                                              const GeneratorOptions &options) {
+  std::ostringstream oss;
+  oss << "std::size_t " << class_node.name
+      << "::hash_value() const noexcept {\n    std::size_t seed = "
+      << (class_node.base_class ? *class_node.base_class + "::hash_value()"
+                                : "0")
+      << ";\n";
+  for (const DataMember &member : emitted_data_members(class_node, options)) {
+    oss << "    seed ^= std::hash<" << format_type(member.type) << ">{}("
+        << trasform_pascal_case_name(member.name)
+        << ") + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);\n";
+  }
+  oss << "    return seed;\n}\n";
+  return oss.str();
+}
+
+std::string
+CodeGenerator::generate_hash_specialization(const std::string &class_name) {
+  return "\nnamespace std {\ntemplate <> struct hash<" + class_name +
+         "> {\n    std::size_t operator()(const " + class_name +
+         "& value) const noexcept {\n        return value.hash_value();\n    "
+         "}\n};\n} // namespace std\n";
+}
+
+// Hash containers need operator== callable on const objects
+bool CodeGenerator::is_equals_const(const GeneratorOptions &options) {
+  return options.signature_policy == SignaturePolicy::Performance ||
+         options.hash_support;
+}
+
+bool CodeGenerator::has_equals_method(const ClassNode &class_node) {
+  for (const MethodNode &method : class_node.methods) {
+    if (method.name == "Equals")
+      return true;
+  }
+  return false;
+}
+
+void CodeGenerator::generate_hash_check(
+    const std::vector<ClassNode> &class_nodes,
+    const std::vector<std::string> &headers, std::ostream &of) {
+  of << "#include <cstdio>\n#include <functional>\n";
+  for (const std::string &header : headers) {
+    of << "#include \"" << header << "\"\n";
+  }
+  of << "\n// Checks that equal objects hash equally for every generated "
+        "class\n"
+        "template <typename T> static bool check_hash_equality(const char "
+        "*name) {\n"
+        "    static T original; // Static storage, members start zeroed\n"
+        "    T copy = original;\n"
+        "    if (!(copy == original) ||\n"
+        "        std::hash<T>{}(copy) != std::hash<T>{}(original)) {\n"
+        "        std::printf(\"Hash and equality disagree for %s\\n\", "
+        "name);\n"
+        "        return false;\n"
+        "    }\n"
+        "    return true;\n"
+        "}\n\n"
+        "int main() {\n"
+        "    bool consistent = true;\n";
+  for (const ClassNode &class_node : class_nodes) {
+    of << "    consistent = check_hash_equality<" << class_node.name << ">(\""
+       << class_node.name << "\") && consistent;\n";
+  }
+  of << "    return consistent ? 0 : 1;\n}\n";
+}
+
+// Include and declaration analysis
+
+std::set<std::string>
+CodeGenerator::required_standard_headers(const ClassNode &class_node,
+                                         const GeneratorOptions &options) {
+  const TypeTable &type_table = TypeTable::active();
+  std::set<std::string> headers;
+  auto add = [&headers, &type_table](const std::string &type) {
+    const TypeMapping *mapping = type_table.find(type);
+    if (mapping && !mapping->header.empty()) {
+      headers.insert(mapping->header);
+    }
+  };
+
+  for (const FieldNode &field : class_node.fields) {
+    add(field.type);
+  }
+  for (const PropertyNode &property : class_node.properties) {
+    add(property.type);
+    for (const PropertyAcessor &accessor : property.accessors) {
+      if (accessor.operation == "set" && !accessor.has_brackets &&
+          moves_into_setter(property, options)) {
+        headers.insert("<utility>"); // std::move in the inline setter
+      }
+    }
+  }
+  if (options.hash_support) {
+    headers.insert("<cstddef>");
+    headers.insert("<functional>");
+  }
+  for (const MethodNode &method : class_node.methods) {
+    if (method.name == "Equals" || method.name == class_node.name)
+      continue; // Signatures not emitted as written
+    if (method.return_type)
+      add(*method.return_type);
+    for (const MethodParam &param : method.parameters) {
+      add(param.type);
+    }
+  }
+  return headers;
+}
+
+std::set<std::string>
+CodeGenerator::complete_type_dependencies(const ClassNode &class_node) {
+  std::set<std::string> types;
+  auto add = [&](const std::string &type) {
+    if (is_class_type(type) && type != class_node.name) {
+      types.insert(type);
+    }
+  };
+
+  if (class_node.base_class) {
+    add(*class_node.base_class);
+  }
+  for (const FieldNode &field : class_node.fields) {
+    add(field.type);
+  }
+  for (const PropertyNode &property : class_node.properties) {
+    add(property.type);
+  }
+  return types;
+}
+
+std::set<std::string>
+CodeGenerator::forward_declared_types(const ClassNode &class_node) {
+  std::set<std::string> complete_types =
+      complete_type_dependencies(class_node);
+  std::set<std::string> types;
+  auto add = [&](const std::string &type) {
+    if (is_class_type(type) && type != class_node.name &&
+        complete_types.find(type) == complete_types.end()) {
+      types.insert(type);
+    }
+  };
+
+  for (const MethodNode &method : class_node.methods) {
+    if (method.name == "Equals" || method.name == class_node.name)
+      continue; // Signatures not emitted as written
+    if (method.return_type)
+      add(*method.return_type);
+    for (const MethodParam &param : method.parameters) {
+      add(param.type);
+    }
+  }
+  return types;
+}
+
+// Anything without a type mapping is one of the generated classes
+bool CodeGenerator::is_class_type(const std::string &type) {
+  return !TypeTable::active().contains(type);
+}
+
+std::vector<DataMember>
+CodeGenerator::data_members(const ClassNode &class_node) {
+  std::vector<DataMember> members;
+  for (const FieldNode &field : class_node.fields) {
+    members.push_back(DataMember{field.access.value_or(AccessModifier::Private),
+                                 field.type, field.name});
+  }
+  for (const PropertyNode &property : class_node.properties) {
+    members.push_back(DataMember{backing_field_access(property), property.type,
+                                 property.name});
+  }
+
+  auto block_position = [](AccessModifier access) {
+    return std::find(ACCESS_BLOCK_ORDER.begin(), ACCESS_BLOCK_ORDER.end(),
+                     access) -
+           ACCESS_BLOCK_ORDER.begin();
+  };
+  std::stable_sort(members.begin(), members.end(),
+                   [&](const DataMember &a, const DataMember &b) {
+                     return block_position(a.access) <
+                            block_position(b.access);
+                   });
+  return members;
+}
+
+std::vector<DataMember>
+CodeGenerator::emitted_data_members(const ClassNode &class_node,
+                                    const GeneratorOptions &options) {
+  std::vector<DataMember> members = data_members(class_node);
+  if (options.pack_fields) {
+    members = FieldLayout::pack_members(class_node, options.class_layouts);
+  }
+  return members;
+}
+
+// Public (or unspecified) properties keep their backing field private
+AccessModifier
+CodeGenerator::backing_field_access(const PropertyNode &property) {
+  if (!property.access.has_value() ||
+      property.access.value() == AccessModifier::Public) {
+    return AccessModifier::Private;
+  }
+  return property.access.value();
+}
+
+// Strings, classes and mapped types marked by-reference are not cheap to copy
+bool CodeGenerator::is_passed_by_reference(const std::string &type) {
+  const TypeMapping *mapping = TypeTable::active().find(type);
+  return mapping ? mapping->passed_by_reference : true;
 }
 
 // Other Auxiliary Functions
@@ -255,47 +715,19 @@ std::string CodeGenerator::generate_modifier_string(AccessModifier access) {
   return "private";
 }
 
-std::string CodeGenerator::trasform_snake_case_name(std::string original_name) {
-  std::ostringstream oss;
-  bool capitalize_next = true;
-
-  for (char ch : original_name) {
-    if (ch == '_') {
-      capitalize_next = true;
-    } else {
-      if (capitalize_next) {
-        oss << static_cast<char>(std::toupper(ch));
-        capitalize_next = false;
-      } else {
-        oss << ch;
-      }
-    }
-  }
-
-  return oss.str(); // Converts snake_case to PascalCase
+// Converts snake_case to PascalCase
+const std::string &
+CodeGenerator::trasform_snake_case_name(const std::string &original_name) {
+  return NameTransformer::to_pascal_case(original_name);
 }
 
-std::string
-CodeGenerator::trasform_pascal_case_name(std::string original_name) {
-  std::ostringstream oss;
-
-  for (size_t i = 0; i < original_name.size(); ++i) {
-    char ch = original_name[i];
-    if (std::isupper(ch)) {
-      if (i != 0)
-        oss << '_';
-      oss << static_cast<char>(std::tolower(ch));
-    } else {
-      oss << ch;
-    }
-  }
-
-  return oss.str(); // Converts PascalCase to snake_case
+// Converts PascalCase to snake_case
+const std::string &
+CodeGenerator::trasform_pascal_case_name(const std::string &original_name) {
+  return NameTransformer::to_snake_case(original_name);
 }
 
 std::string CodeGenerator::format_type(const std::string &type) {
-  if (type == "string") {
-    return "std::string";
-  }
-  return type;
+  const TypeMapping *mapping = TypeTable::active().find(type);
+  return mapping ? mapping->cpp_type : type;
 }
\ No newline at end of file
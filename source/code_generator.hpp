@@ -1,28 +1,117 @@
 #ifndef CODE_GENERATOR
 #define CODE_GENERATOR
 
+#include "field_layout.hpp"
 #include "lexer.hpp"
 #include "parser.hpp"
 #include <fstream>
+#include <set>
 #include <string>
 
+// File holding the program written by generate_hash_check
+#define HASH_CHECK_FILE_NAME "hash_equality_check.cpp"
+
+// How member function signatures are emitted
+enum class SignaturePolicy {
+  Literal,    // Types as written in C#, everything passed and returned by value
+  Performance // const& for non-trivial types, const getters and operator==,
+              // explicitly defaulted copy and move operations
+};
+
+struct GeneratorOptions {
+  SignaturePolicy signature_policy = SignaturePolicy::Literal;
+  // Order the data members of each access block for minimal padding, using
+  // class_layouts (if set) for the size of class-typed members
+  bool pack_fields = false;
+  const ClassLayouts *class_layouts = nullptr;
+  // Memberwise operator== and a std::hash specialization for every class
+  bool hash_support = false;
+};
+
 class CodeGenerator {
 public:
   static void generate_header(const ClassNode &class_node, std::ostream &of);
+  static void generate_header(const ClassNode &class_node, std::ostream &of,
+                              const GeneratorOptions &options);
+  // The class body alone, without include guard, includes or declarations
+  static void generate_class_declaration(const ClassNode &class_node,
+                                         std::ostream &of);
+  static void generate_class_declaration(const ClassNode &class_node,
+                                         std::ostream &of,
+                                         const GeneratorOptions &options);
   static void generate_source(const ClassNode &class_node, std::ostream &of);
+  static void generate_source(const ClassNode &class_node, std::ostream &of,
+                              const GeneratorOptions &options);
+  // Member definitions only, without the include of the class header
+  static void generate_source_body(const ClassNode &class_node,
+                                   std::ostream &of);
+  static void generate_source_body(const ClassNode &class_node,
+                                   std::ostream &of,
+                                   const GeneratorOptions &options);
+
+  // Include lines ("<string>") for the standard types the class uses
+  static std::set<std::string>
+  required_standard_headers(const ClassNode &class_node,
+                            const GeneratorOptions &options);
+  // Classes the header needs as complete types: base class and by-value
+  // fields and properties
+  static std::set<std::string>
+  complete_type_dependencies(const ClassNode &class_node);
+  // Classes only named in method signatures, forward declared in the header
+  static std::set<std::string>
+  forward_declared_types(const ClassNode &class_node);
+  static bool is_class_type(const std::string &type);
+  // Fields and property backing fields in the order they are emitted
+  // without packing, access blocks in output order
+  static std::vector<DataMember> data_members(const ClassNode &class_node);
+  // Data members in the order they appear in the generated header
+  static std::vector<DataMember>
+  emitted_data_members(const ClassNode &class_node,
+                       const GeneratorOptions &options);
+
+  // Program checking that equal objects of every class hash equally
+  static void generate_hash_check(const std::vector<ClassNode> &class_nodes,
+                                  const std::vector<std::string> &headers,
+                                  std::ostream &of);
 
 private:
   static std::string generate_modifier_string(AccessModifier access);
+  static AccessModifier backing_field_access(const PropertyNode &property);
+  static void
+  pack_field_lines(std::vector<std::string> &lines,
+                   const std::vector<std::pair<std::size_t, FieldNode>> &slots,
+                   AccessModifier access,
+                   const std::vector<DataMember> &packed);
   static std::string generate_field(const FieldNode &field);
-  static std::string generate_method_declaration(const MethodNode &method,
-                                                 const std::string &class_name);
-  static std::string generate_method_definition(const MethodNode &method,
-                                                const std::string &class_name);
   static std::string
-  generate_property_declarations(const PropertyNode &property);
+  generate_method_declaration(const MethodNode &method,
+                              const std::string &class_name,
+                              const GeneratorOptions &options);
+  static std::string
+  generate_method_definition(const MethodNode &method,
+                             const ClassNode &class_node,
+                             const GeneratorOptions &options);
+  static std::string
+  generate_property_declarations(const PropertyNode &property,
+                                 const GeneratorOptions &options);
   static std::string
   generate_property_definitions(const PropertyNode &property,
-                                const std::string &class_name);
+                                const std::string &class_name,
+                                const GeneratorOptions &options);
+  static std::string generate_getter_signature(const PropertyNode &property,
+                                               const PropertyAcessor &accessor,
+                                               const std::string &scope,
+                                               const GeneratorOptions &options);
+  static std::string generate_setter_signature(const PropertyNode &property,
+                                               const std::string &scope);
+  static std::string
+  generate_inline_accessor_body(const PropertyNode &property,
+                                const PropertyAcessor &accessor,
+                                const GeneratorOptions &options);
+  static bool moves_into_setter(const PropertyNode &property,
+                                const GeneratorOptions &options);
+  static std::vector<std::string>
+  generate_copy_and_move_declarations(const std::string &class_name);
   static std::string
   generate_constructor_declaration(const std::string &class_name);
   static std::string
@@ -31,13 +120,31 @@ private:
   generate_destructor_declaration(const std::string &class_name);
   static std::string
   generate_destructor_definition(const std::string &class_name);
-  static std::string generate_equals_declaration(const std::string &class_name);
-  static std::string generate_equals_definition(const std::string &class_name);
   static std::string
-  generate_param_list(const std::vector<MethodParam> &params);
+  generate_equals_declaration(const std::string &class_name,
+                              const GeneratorOptions &options);
+  static std::string
+  generate_equals_definition(const ClassNode &class_node,
+                             const GeneratorOptions &options);
+  static bool is_equals_const(const GeneratorOptions &options);
+  static bool has_equals_method(const ClassNode &class_node);
+  static std::string
+  generate_hash_value_definition(const ClassNode &class_node,
+                                 const GeneratorOptions &options);
+  static std::string
+  generate_hash_specialization(const std::string &class_name);
+  static std::string
+  generate_param_list(const std::vector<MethodParam> &params,
+                      const GeneratorOptions &options);
+  static std::string generate_param_type(const std::string &type,
+                                         const GeneratorOptions &options);
+  static bool is_passed_by_reference(const std::string &type);
 
-  static std::string trasform_snake_case_name(std::string original_name);
-  static std::string trasform_pascal_case_name(std::string original_name);
+  // Memoized for the whole run, see NameTransformer
+  static const std::string &
+  trasform_snake_case_name(const std::string &original_name);
+  static const std::string &
+  trasform_pascal_case_name(const std::string &original_name);
   static std::string format_type(const std::string &type);
 };
 
@@ -0,0 +1,398 @@
+#include "conversion_server.hpp"
+#include "custom_exceptions.hpp"
+#include "file_handler.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <poll.h>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// First field of every message, changed with any change to the framing
+#define PROTOCOL_VERSION "cs-converter 1"
+// Requests that announce more than this are refused before allocating
+#define MAX_REQUEST_ARGUMENTS 4096
+// A client that stops sending (or reading) cannot hold the server longer
+#define CONNECTION_TIMEOUT_SECONDS 10
+
+static IO_Exception socket_error(const std::string &what) {
+  return IO_Exception((what + ": " + std::strerror(errno)).c_str());
+}
+
+static IO_Exception malformed_message(const std::string &reason) {
+  return IO_Exception(("Malformed conversion message: " + reason).c_str());
+}
+
+static void append_field(std::string &message, std::string_view field) {
+  message += std::to_string(field.size());
+  message += '\n';
+  message.append(field);
+}
+
+static void send_all(int fd, const std::string &data) {
+  std::size_t sent = 0;
+  while (sent < data.size()) {
+    // MSG_NOSIGNAL: a client that went away must not kill the server
+    ssize_t count =
+        ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw socket_error("Failed to send on the conversion socket");
+    }
+    sent += static_cast<std::size_t>(count);
+  }
+}
+
+// Reads the fields of one message through a buffer
+class FieldReader {
+public:
+  explicit FieldReader(int fd) : fd(fd), buffer(STREAM_BUFFER_SIZE / 16) {}
+
+  std::string field() {
+    std::size_t length = 0;
+    int digits = 0;
+    for (char c = next_byte(); c != '\n' || digits == 0; c = next_byte()) {
+      if (c < '0' || c > '9' || digits == 10) {
+        throw malformed_message("invalid field length");
+      }
+      length = length * 10 + static_cast<std::size_t>(c - '0');
+      digits++;
+    }
+    if (length > MAX_INPUT_FILE_SIZE) {
+      throw malformed_message("field larger than the input size limit");
+    }
+
+    std::string value;
+    value.reserve(length);
+    while (value.size() < length) {
+      if (start == end) {
+        fill();
+      }
+      std::size_t count = std::min(length - value.size(), end - start);
+      value.append(buffer.data() + start, count);
+      start += count;
+    }
+    return value;
+  }
+
+  std::size_t number(std::size_t max_value) {
+    std::string text = field();
+    std::size_t value = 0;
+    if (text.empty() || text.size() > 10 ||
+        text.find_first_not_of("0123456789") != std::string::npos ||
+        (value = std::stoul(text)) > max_value) {
+      throw malformed_message("invalid number '" + text + "'");
+    }
+    return value;
+  }
+
+  void expect_version() {
+    if (field() != PROTOCOL_VERSION) {
+      throw malformed_message("unsupported protocol version");
+    }
+  }
+
+private:
+  int fd;
+  std::vector<char> buffer;
+  std::size_t start = 0;
+  std::size_t end = 0;
+
+  char next_byte() {
+    if (start == end) {
+      fill();
+    }
+    return buffer[start++];
+  }
+
+  void fill() {
+    ssize_t count;
+    do {
+      count = ::read(fd, buffer.data(), buffer.size());
+    } while (count < 0 && errno == EINTR);
+    if (count < 0) {
+      throw socket_error("Failed to read from the conversion socket");
+    }
+    if (count == 0) {
+      throw malformed_message("connection closed mid-message");
+    }
+    start = 0;
+    end = static_cast<std::size_t>(count);
+  }
+};
+
+static std::string encode_request(const ConversionRequest &request) {
+  std::string message;
+  append_field(message, PROTOCOL_VERSION);
+  append_field(message, request.working_directory);
+  append_field(message, std::to_string(request.arguments.size()));
+  for (const std::string &argument : request.arguments) {
+    append_field(message, argument);
+  }
+  append_field(message, request.standard_input);
+  return message;
+}
+
+static ConversionRequest read_request(FieldReader &reader) {
+  ConversionRequest request;
+  reader.expect_version();
+  request.working_directory = reader.field();
+  std::size_t argument_count = reader.number(MAX_REQUEST_ARGUMENTS);
+  for (std::size_t i = 0; i < argument_count; i++) {
+    request.arguments.push_back(reader.field());
+  }
+  request.standard_input = reader.field();
+  return request;
+}
+
+static std::string encode_response(const ConversionResponse &response) {
+  std::string message;
+  append_field(message, PROTOCOL_VERSION);
+  append_field(message, std::to_string(response.exit_status & 0xFF));
+  append_field(message, response.standard_output);
+  append_field(message, response.standard_error);
+  return message;
+}
+
+static ConversionResponse read_response(FieldReader &reader) {
+  ConversionResponse response;
+  reader.expect_version();
+  response.exit_status = static_cast<int>(reader.number(0xFF));
+  response.standard_output = reader.field();
+  response.standard_error = reader.field();
+  return response;
+}
+
+static sockaddr_un socket_address(const std::string &socket_path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    throw IO_Exception(
+        ("Socket path '" + socket_path + "' is too long").c_str());
+  }
+  std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+  return address;
+}
+
+// Connected socket, or -1 with errno set
+static int connect_to(const std::string &socket_path) {
+  sockaddr_un address = socket_address(socket_path);
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  if (::connect(fd, reinterpret_cast<sockaddr *>(&address),
+                sizeof(address)) != 0) {
+    int saved_errno = errno;
+    ::close(fd);
+    errno = saved_errno;
+    return -1;
+  }
+  return fd;
+}
+
+// A socket file nobody accepts on, left behind by a server that was killed
+static bool is_stale_socket(const std::string &socket_path) {
+  struct stat status;
+  if (::lstat(socket_path.c_str(), &status) != 0 ||
+      !S_ISSOCK(status.st_mode)) {
+    return false;
+  }
+  int fd = connect_to(socket_path);
+  if (fd >= 0) {
+    ::close(fd);
+    return false;
+  }
+  return errno == ECONNREFUSED;
+}
+
+// Whether the process on the other end of a connection runs as this user
+static bool peer_is_same_user(int fd) {
+  ucred credentials;
+  socklen_t length = sizeof(credentials);
+  return ::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) ==
+             0 &&
+         credentials.uid == ::getuid();
+}
+
+// The directory of the socket is created private when missing, and must
+// not let other users replace the socket: it is owned by this user or,
+// like /tmp, sticky
+static void ensure_socket_directory(const std::string &socket_path) {
+  std::string directory =
+      std::filesystem::path(socket_path).parent_path().string();
+  if (::mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+    throw socket_error("Failed to create '" + directory + "'");
+  }
+  struct stat status;
+  if (::lstat(directory.c_str(), &status) != 0 ||
+      !S_ISDIR(status.st_mode) ||
+      (status.st_uid != ::getuid() && !(status.st_mode & S_ISVTX))) {
+    throw IO_Exception(("'" + directory +
+                        "' is not a directory other users cannot change")
+                           .c_str());
+  }
+}
+
+static int listen_on(const std::string &socket_path) {
+  sockaddr_un address = socket_address(socket_path);
+  ensure_socket_directory(socket_path);
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    throw socket_error("Failed to create the conversion socket");
+  }
+  // Conversions read and write the client's files, only its owner may ask.
+  // The socket is created with these permissions, not changed after bind.
+  auto bind_socket = [&]() {
+    mode_t previous_mask = ::umask(077);
+    bool bound = ::bind(fd, reinterpret_cast<sockaddr *>(&address),
+                        sizeof(address)) == 0;
+    int saved_errno = errno;
+    ::umask(previous_mask);
+    errno = saved_errno;
+    return bound;
+  };
+  bool bound = bind_socket();
+  if (!bound && errno == EADDRINUSE && is_stale_socket(socket_path)) {
+    ::unlink(socket_path.c_str());
+    bound = bind_socket();
+  }
+  if (!bound || ::chmod(socket_path.c_str(), 0600) != 0 ||
+      ::listen(fd, SOMAXCONN) != 0) {
+    IO_Exception error =
+        socket_error("Failed to listen on '" + socket_path + "'");
+    if (bound) {
+      ::unlink(socket_path.c_str());
+    }
+    ::close(fd);
+    throw error;
+  }
+  return fd;
+}
+
+ConversionServer::ConversionServer(const std::string &socket_path,
+                                   Handler handler)
+    : path(std::filesystem::absolute(socket_path).string()),
+      handler(std::move(handler)) {
+  if (::pipe2(stop_pipe, O_CLOEXEC) != 0) {
+    throw socket_error("Failed to create the server stop pipe");
+  }
+  try {
+    listen_fd = listen_on(path);
+  } catch (...) {
+    ::close(stop_pipe[0]);
+    ::close(stop_pipe[1]);
+    throw;
+  }
+}
+
+ConversionServer::~ConversionServer() {
+  ::close(listen_fd);
+  ::unlink(path.c_str());
+  ::close(stop_pipe[0]);
+  ::close(stop_pipe[1]);
+}
+
+void ConversionServer::serve() {
+  while (true) {
+    pollfd events[2] = {{stop_pipe[0], POLLIN, 0}, {listen_fd, POLLIN, 0}};
+    if (::poll(events, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw socket_error("Failed to wait for conversion requests");
+    }
+    if (events[0].revents) {
+      return;
+    }
+    if (!(events[1].revents & POLLIN)) {
+      continue;
+    }
+    int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      continue; // Interrupted, or the client already gave up
+    }
+    // Only the user running the server may convert through it
+    if (peer_is_same_user(fd)) {
+      handle_connection(fd);
+    }
+    ::close(fd);
+  }
+}
+
+void ConversionServer::stop() {
+  char byte = 0;
+  ssize_t ignored = ::write(stop_pipe[1], &byte, 1);
+  (void)ignored;
+}
+
+const std::string &ConversionServer::socket_path() const { return path; }
+
+std::size_t ConversionServer::requests_served() const { return served.load(); }
+
+std::string ConversionServer::default_socket_path() {
+  const char *configured = std::getenv("CS_CONVERTER_SOCKET");
+  if (configured && *configured) {
+    return configured;
+  }
+  const char *runtime_directory = std::getenv("XDG_RUNTIME_DIR");
+  if (runtime_directory && *runtime_directory) {
+    return std::string(runtime_directory) + "/cs_converter.sock";
+  }
+  return "/tmp/cs_converter-" + std::to_string(::getuid()) + "/server.sock";
+}
+
+void ConversionServer::handle_connection(int fd) {
+  timeval timeout{CONNECTION_TIMEOUT_SECONDS, 0};
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  ConversionResponse response;
+  try {
+    FieldReader reader(fd);
+    ConversionRequest request = read_request(reader);
+    response = handler(request);
+  } catch (const std::exception &e) {
+    response.exit_status = EXIT_FAILURE;
+    response.standard_error = std::string(e.what()) + "\n";
+  }
+  try {
+    send_all(fd, encode_response(response));
+  } catch (const IO_Exception &) {
+    // The client went away, nobody is left to tell
+  }
+  served++;
+}
+
+ConversionResponse ConversionClient::send(const std::string &socket_path,
+                                          const ConversionRequest &request) {
+  int fd = connect_to(socket_path);
+  if (fd < 0) {
+    throw socket_error("No conversion server is listening on '" +
+                       socket_path + "'");
+  }
+  struct Connection {
+    int fd;
+    ~Connection() { ::close(fd); }
+  } connection{fd};
+  // Anyone can listen on a path in a shared directory first; the request
+  // carries the caller's directory, arguments and input
+  if (!peer_is_same_user(fd)) {
+    throw IO_Exception(("The conversion server on '" + socket_path +
+                        "' is run by another user")
+                           .c_str());
+  }
+
+  send_all(fd, encode_request(request));
+  FieldReader reader(fd);
+  return read_response(reader);
+}
@@ -0,0 +1,74 @@
+#ifndef CONVERSION_SERVER
+#define CONVERSION_SERVER
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A conversion as the command line would run it: the arguments (without
+// the program name), the directory they are relative to and, for "-", the
+// text that would have come from standard input
+struct ConversionRequest {
+  std::string working_directory;
+  std::vector<std::string> arguments;
+  std::string standard_input;
+};
+
+// What the command line run would have printed, and its exit status
+struct ConversionResponse {
+  int exit_status = 0;
+  std::string standard_output;
+  std::string standard_error;
+};
+
+// Long-lived converter listening on a Unix domain socket, so that repeated
+// conversions skip process start-up and reuse the state the handler keeps
+// warm. Every connection carries one request and one response, framed as
+// "<decimal length>\n<bytes>" fields; requests are handled one at a time,
+// in the order they are accepted.
+class ConversionServer {
+public:
+  using Handler = std::function<ConversionResponse(const ConversionRequest &)>;
+
+  // Binds and listens, accepting connections of this user only; a socket
+  // left behind by a server that is no longer running is replaced. A
+  // missing socket directory is created private. Throws IO_Exception.
+  ConversionServer(const std::string &socket_path, Handler handler);
+  ~ConversionServer();
+
+  ConversionServer(const ConversionServer &) = delete;
+  ConversionServer &operator=(const ConversionServer &) = delete;
+
+  // Handles requests until stop() is called
+  void serve();
+  // Async-signal-safe, may be called from a signal handler or any thread
+  void stop();
+
+  const std::string &socket_path() const;
+  std::size_t requests_served() const;
+
+  // $CS_CONVERTER_SOCKET, else a socket in $XDG_RUNTIME_DIR, else one in a
+  // private per-user directory in /tmp
+  static std::string default_socket_path();
+
+private:
+  std::string path; // Absolute, the working directory may change
+  Handler handler;
+  int listen_fd = -1;
+  int stop_pipe[2] = {-1, -1};
+  std::atomic<std::size_t> served{0};
+
+  void handle_connection(int fd);
+};
+
+class ConversionClient {
+public:
+  // Throws IO_Exception when no server answers at socket_path, or when the
+  // server runs as another user
+  static ConversionResponse send(const std::string &socket_path,
+                                 const ConversionRequest &request);
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include "converter.hpp"
+#include "field_layout.hpp"
+#include "lexer.hpp"
+#include "validator.hpp"
+#include <future>
+#include <sstream>
+
+ConvertedSource Converter::convert(std::string_view source,
+                                   const ConverterOptions &options) {
+  return generate(parse(source), options);
+}
+
+std::vector<ClassNode> Converter::parse(std::string_view source) {
+  Lexer lexer(source);
+  Parser parser(lexer);
+  std::vector<ClassNode> class_nodes = parser.parseProgram();
+  Validator::ensure_valid_structure(class_nodes);
+  return class_nodes;
+}
+
+ConvertedSource Converter::generate(const std::vector<ClassNode> &class_nodes,
+                                    const ConverterOptions &options) {
+  // Packed layouts must outlive rendering, the options point to them
+  GeneratorOptions generator = options.generator;
+  ClassLayouts packed_layouts;
+  generator.class_layouts = nullptr;
+  if (generator.pack_fields) {
+    packed_layouts = FieldLayout::compute_class_layouts(class_nodes, true);
+    generator.class_layouts = &packed_layouts;
+  }
+
+  ThreadPool inline_pool(0);
+  std::vector<std::future<GeneratedClass>> pending =
+      GenerationStage::render_all(class_nodes, generator,
+                                  options.pool ? *options.pool : inline_pool);
+  // Every task is done with the layouts before a failure is rethrown
+  for (std::future<GeneratedClass> &result : pending) {
+    result.wait();
+  }
+  ConvertedSource converted;
+  converted.classes.reserve(class_nodes.size());
+  for (std::future<GeneratedClass> &result : pending) {
+    converted.classes.push_back(result.get());
+  }
+
+  if (generator.hash_support) {
+    std::vector<std::string> headers;
+    for (const ClassNode &class_node : class_nodes) {
+      headers.push_back(class_node.name + ".hpp");
+    }
+    std::ostringstream check;
+    CodeGenerator::generate_hash_check(class_nodes, headers, check);
+    converted.hash_check = check.str();
+  }
+  for (const ClassNode &class_node : class_nodes) {
+    converted.members += class_node.fields.size() +
+                         class_node.methods.size() +
+                         class_node.properties.size();
+  }
+  return converted;
+}
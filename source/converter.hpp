@@ -0,0 +1,47 @@
+#ifndef CONVERTER
+#define CONVERTER
+
+#include "code_generator.hpp"
+#include "generation_stage.hpp"
+#include "parser.hpp"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ConverterOptions {
+  // class_layouts is ignored, the packed layouts are computed per conversion
+  GeneratorOptions generator;
+  // Classes are rendered on the pool when set, on the calling thread if not
+  ThreadPool *pool = nullptr;
+};
+
+// Everything generated from one source text
+struct ConvertedSource {
+  std::vector<GeneratedClass> classes; // In declaration order
+  std::string hash_check; // Program named HASH_CHECK_FILE_NAME, with
+                          // hash_support only; includes "<class>.hpp"
+  std::size_t members = 0; // Fields, methods and properties
+};
+
+// In-memory conversion for programs linking the cs_converter library: source
+// text in, generated buffers out, without touching the file system or the
+// standard streams. Type mappings are those of TypeTable::active(), install
+// them (TypeTable::parse() reads them from any stream) before converting.
+// Conversions may run concurrently once the table is installed.
+class Converter {
+public:
+  // Throws Parser_Exception or Validator_Exception for invalid input, and
+  // Code_Generation_Exception
+  static ConvertedSource convert(std::string_view source,
+                                 const ConverterOptions &options);
+
+  // Lexed, parsed and validated classes; the source is only read during the
+  // call
+  static std::vector<ClassNode> parse(std::string_view source);
+  static ConvertedSource generate(const std::vector<ClassNode> &class_nodes,
+                                  const ConverterOptions &options);
+};
+
+#endif
@@ -54,4 +54,16 @@ public:
   const char *what() const noexcept override { return full_message.c_str(); }
 };
 
+class Options_Exception : public std::exception {
+private:
+  std::string message;
+  std::string full_message;
+
+public:
+  Options_Exception(const char *msg)
+      : message(msg), full_message("Options_Exception: " + message) {}
+
+  const char *what() const noexcept override { return full_message.c_str(); }
+};
+
 #endif 
\ No newline at end of file
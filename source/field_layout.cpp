@@ -0,0 +1,180 @@
+#include "field_layout.hpp"
+#include "code_generator.hpp"
+#include "type_table.hpp"
+#include "unity_builder.hpp"
+#include <algorithm>
+#include <string>
+
+static std::size_t align_up(std::size_t offset, std::size_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+TypeLayout FieldLayout::type_layout(const std::string &type,
+                                    const ClassLayouts *class_layouts) {
+  // Same table as the validator and the generator, mapped types included
+  if (const TypeMapping *mapping = TypeTable::active().find(type)) {
+    if (mapping->size && mapping->alignment) {
+      return TypeLayout{mapping->size, mapping->alignment, false};
+    }
+  } else if (class_layouts) {
+    auto known = class_layouts->find(type);
+    if (known != class_layouts->end()) {
+      return known->second;
+    }
+  }
+  // Unknown types are assumed to be pointer-like
+  return TypeLayout{sizeof(void *), alignof(void *), false};
+}
+
+std::vector<std::size_t>
+FieldLayout::packed_order(const std::vector<std::string> &types,
+                          const ClassLayouts *class_layouts) {
+  std::vector<TypeLayout> layouts;
+  std::vector<std::size_t> order;
+  for (std::size_t i = 0; i < types.size(); i++) {
+    layouts.push_back(type_layout(types[i], class_layouts));
+    order.push_back(i);
+  }
+
+  std::stable_sort(order.begin(), order.end(),
+                   [&layouts](std::size_t a, std::size_t b) {
+                     if (layouts[a].alignment != layouts[b].alignment) {
+                       return layouts[a].alignment > layouts[b].alignment;
+                     }
+                     return layouts[a].size > layouts[b].size;
+                   });
+  return order;
+}
+
+// Where the first data member may go: after a non-empty base class
+static std::size_t members_offset(const ClassNode &class_node,
+                                  const ClassLayouts *class_layouts) {
+  if (!class_node.base_class) {
+    return 0;
+  }
+  TypeLayout base = FieldLayout::type_layout(*class_node.base_class,
+                                             class_layouts);
+  return base.is_empty ? 0 : base.size;
+}
+
+// Offset just past the given types when laid out from offset in that order
+static std::size_t end_offset(std::size_t offset,
+                              const std::vector<std::string> &types,
+                              const std::vector<std::size_t> &order,
+                              const ClassLayouts *class_layouts) {
+  for (std::size_t index : order) {
+    TypeLayout layout = FieldLayout::type_layout(types[index], class_layouts);
+    offset = align_up(offset, layout.alignment) + layout.size;
+  }
+  return offset;
+}
+
+std::vector<DataMember>
+FieldLayout::pack_members(const ClassNode &class_node,
+                          const ClassLayouts *class_layouts) {
+  // Packing never moves a member out of its access block
+  std::vector<DataMember> members = CodeGenerator::data_members(class_node);
+  std::vector<DataMember> packed_members;
+  std::size_t offset = members_offset(class_node, class_layouts);
+  for (std::size_t begin = 0; begin < members.size();) {
+    std::size_t end = begin;
+    std::vector<std::string> types;
+    while (end < members.size() &&
+           members[end].access == members[begin].access) {
+      types.push_back(members[end++].type);
+    }
+
+    // A block starting after a smaller member of the previous one may end
+    // earlier with its smallest members first, filling the gap
+    std::vector<std::size_t> order = packed_order(types, class_layouts);
+    std::vector<std::size_t> ascending(order);
+    std::sort(ascending.begin(), ascending.end());
+    std::stable_sort(ascending.begin(), ascending.end(),
+                     [&](std::size_t a, std::size_t b) {
+                       return type_layout(types[a], class_layouts).alignment <
+                              type_layout(types[b], class_layouts).alignment;
+                     });
+    std::size_t descending_end =
+        end_offset(offset, types, order, class_layouts);
+    std::size_t ascending_end =
+        end_offset(offset, types, ascending, class_layouts);
+    if (ascending_end < descending_end) {
+      order = std::move(ascending);
+    }
+    offset = std::min(descending_end, ascending_end);
+
+    for (std::size_t index : order) {
+      packed_members.push_back(members[begin + index]);
+    }
+    begin = end;
+  }
+
+  // Reordering only pays when the class gets smaller
+  if (members_layout(class_node, packed_members, class_layouts).size <
+      members_layout(class_node, members, class_layouts).size) {
+    return packed_members;
+  }
+  return members;
+}
+
+TypeLayout FieldLayout::class_layout(const ClassNode &class_node, bool packed,
+                                     const ClassLayouts &class_layouts) {
+  return members_layout(class_node,
+                        packed ? pack_members(class_node, &class_layouts)
+                               : CodeGenerator::data_members(class_node),
+                        &class_layouts);
+}
+
+TypeLayout
+FieldLayout::members_layout(const ClassNode &class_node,
+                            const std::vector<DataMember> &members,
+                            const ClassLayouts *class_layouts) {
+  TypeLayout layout{0, 1, true};
+  if (class_node.base_class) {
+    TypeLayout base = type_layout(*class_node.base_class, class_layouts);
+    layout.alignment = base.alignment;
+    if (!base.is_empty) {
+      layout.size = base.size;
+      layout.is_empty = false;
+    }
+  }
+
+  for (const DataMember &member : members) {
+    TypeLayout member_layout = type_layout(member.type, class_layouts);
+    layout.size = align_up(layout.size, member_layout.alignment) +
+                  member_layout.size;
+    layout.alignment = std::max(layout.alignment, member_layout.alignment);
+    layout.is_empty = false;
+  }
+
+  layout.size = std::max<std::size_t>(align_up(layout.size, layout.alignment),
+                                      1); // Empty classes still take a byte
+  return layout;
+}
+
+ClassLayouts
+FieldLayout::compute_class_layouts(const std::vector<ClassNode> &class_nodes,
+                                   bool packed) {
+  // Dependencies (base classes and by-value members) are laid out first
+  ClassLayouts class_layouts;
+  for (std::size_t index : UnityBuilder::dependency_order(class_nodes)) {
+    const ClassNode &class_node = class_nodes[index];
+    class_layouts.emplace(class_node.name,
+                          class_layout(class_node, packed, class_layouts));
+  }
+  return class_layouts;
+}
+
+std::vector<LayoutReport>
+FieldLayout::report(const std::vector<ClassNode> &class_nodes) {
+  ClassLayouts declared = compute_class_layouts(class_nodes, false);
+  ClassLayouts packed = compute_class_layouts(class_nodes, true);
+
+  std::vector<LayoutReport> reports;
+  for (const ClassNode &class_node : class_nodes) {
+    reports.push_back(LayoutReport{class_node.name,
+                                   declared.at(class_node.name).size,
+                                   packed.at(class_node.name).size});
+  }
+  return reports;
+}
@@ -0,0 +1,69 @@
+#ifndef FIELD_LAYOUT
+#define FIELD_LAYOUT
+
+#include "parser.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Size and alignment of a generated C++ type, as laid out on the host ABI
+struct TypeLayout {
+  std::size_t size = 1;
+  std::size_t alignment = 1;
+  bool is_empty = true; // No data members, takes no space as a base class
+};
+
+using ClassLayouts = std::unordered_map<std::string, TypeLayout>;
+
+// A data member of a generated class (field or property backing field) with
+// the access block it is emitted in
+struct DataMember {
+  AccessModifier access;
+  std::string type;
+  std::string name;
+};
+
+struct LayoutReport {
+  std::string class_name;
+  std::size_t declared_size;
+  std::size_t packed_size;
+};
+
+// Estimates generated class layouts to order fields for minimal padding.
+// Class sizes follow the usual rules (members at aligned offsets, size
+// rounded up to the alignment, empty bases take no space); tail padding
+// reuse of non-POD bases is not modelled.
+class FieldLayout {
+public:
+  static TypeLayout type_layout(const std::string &type,
+                                const ClassLayouts *class_layouts);
+
+  // Indices of the given types by decreasing alignment, then decreasing
+  // size, keeping declaration order between equal types
+  static std::vector<std::size_t>
+  packed_order(const std::vector<std::string> &types,
+               const ClassLayouts *class_layouts);
+
+  // Data members of the class reordered inside each access block, by
+  // packed_order or, when the block starts unaligned and that ends it
+  // earlier, by increasing alignment. The declared order is kept unless the
+  // reordered class is smaller.
+  static std::vector<DataMember>
+  pack_members(const ClassNode &class_node,
+               const ClassLayouts *class_layouts);
+
+  static ClassLayouts
+  compute_class_layouts(const std::vector<ClassNode> &class_nodes,
+                        bool packed);
+  static std::vector<LayoutReport>
+  report(const std::vector<ClassNode> &class_nodes);
+
+private:
+  static TypeLayout class_layout(const ClassNode &class_node, bool packed,
+                                 const ClassLayouts &class_layouts);
+  static TypeLayout members_layout(const ClassNode &class_node,
+                                   const std::vector<DataMember> &members,
+                                   const ClassLayouts *class_layouts);
+};
+
+#endif
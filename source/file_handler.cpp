@@ -1,10 +1,52 @@
 #include "file_handler.hpp"
 #include "custom_exceptions.hpp"
-#include <filesystem>
+#include "trace.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-namespace fs = std::filesystem;
+// Input file contents
+
+InputFile::~InputFile() {
+  if (mapping) {
+    ::munmap(mapping, mapping_size);
+  }
+}
+
+InputFile::InputFile(InputFile &&other) noexcept
+    : mapping(other.mapping), mapping_size(other.mapping_size),
+      buffer(std::move(other.buffer)) {
+  other.mapping = nullptr;
+  other.mapping_size = 0;
+}
+
+InputFile &InputFile::operator=(InputFile &&other) noexcept {
+  if (this != &other) {
+    if (mapping) {
+      ::munmap(mapping, mapping_size);
+    }
+    mapping = other.mapping;
+    mapping_size = other.mapping_size;
+    buffer = std::move(other.buffer);
+    other.mapping = nullptr;
+    other.mapping_size = 0;
+  }
+  return *this;
+}
+
+std::string_view InputFile::view() const {
+  if (mapping) {
+    return {static_cast<const char *>(mapping), mapping_size};
+  }
+  return buffer;
+}
+
+bool InputFile::is_mapped() const { return mapping != nullptr; }
 
 // For handling input files
 std::ifstream FileHandler::create_input_stream(std::string cs_file_path) {
@@ -29,41 +71,167 @@ int FileHandler::get_input_stream_char(std::istream *is) {
   }
 }
 
-// For handling output files
+static IO_Exception input_error(const std::string &cs_file_path,
+                                const std::string &reason) {
+  return IO_Exception(
+      ("Input file '" + cs_file_path + "' " + reason).c_str());
+}
+
+InputFile FileHandler::read_input_file(const std::string &cs_file_path,
+                                       std::size_t max_size) {
+  TraceSpan span("read", "file", cs_file_path);
+  int fd = ::open(cs_file_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw input_error(cs_file_path,
+                      "cannot be opened: " + std::string(std::strerror(errno)));
+  }
+  struct FileDescriptor {
+    int fd;
+    ~FileDescriptor() { ::close(fd); }
+  } guard{fd};
 
-std::pair<std::string, std::string>
-FileHandler::get_class_node_output_file_paths(const std::string &class_name) {
-  return get_class_node_output_file_paths(class_name, ".");
+  return read_input_descriptor(fd, cs_file_path, max_size);
+}
+
+InputFile FileHandler::read_standard_input(std::size_t max_size) {
+  return read_input_descriptor(STDIN_FILENO, "<stdin>", max_size);
+}
+
+InputFile FileHandler::read_input_buffer(std::string contents,
+                                         const std::string &cs_file_path,
+                                         std::size_t max_size) {
+  if (contents.empty()) {
+    throw input_error(cs_file_path, "is empty");
+  }
+  if (contents.size() > max_size) {
+    throw input_error(cs_file_path, "is larger than the " +
+                                        std::to_string(max_size) +
+                                        " byte limit");
+  }
+  InputFile file;
+  file.buffer = std::move(contents);
+  return file;
 }
 
-std::pair<std::string, std::string>
-FileHandler::get_class_node_output_file_paths(
-    const std::string &class_name, const std::string &directory_name) {
-  try {
-    fs::path dir_path(directory_name);
-    if (!fs::exists(dir_path)) {
-      fs::create_directories(dir_path);
+InputFile FileHandler::read_input_descriptor(int fd,
+                                             const std::string &cs_file_path,
+                                             std::size_t max_size) {
+  struct stat status;
+  if (::fstat(fd, &status) != 0) {
+    throw input_error(cs_file_path, "cannot be inspected: " +
+                                        std::string(std::strerror(errno)));
+  }
+  if (S_ISDIR(status.st_mode)) {
+    throw input_error(cs_file_path, "is a directory");
+  }
+
+  InputFile file;
+  // Regular files reporting a size of 0 (e.g. under /proc) are read instead
+  if (S_ISREG(status.st_mode) && status.st_size > 0) {
+    if (static_cast<std::uintmax_t>(status.st_size) > max_size) {
+      throw input_error(cs_file_path, "is larger than the " +
+                                          std::to_string(max_size) +
+                                          " byte limit");
     }
+    std::size_t size = static_cast<std::size_t>(status.st_size);
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+      ::madvise(mapping, size, MADV_SEQUENTIAL); // Only a hint
+      file.mapping = mapping;
+      file.mapping_size = size;
+      return file;
+    }
+    // Some file systems refuse mmap, fall back to reading
+  }
 
-    fs::path header_path = dir_path / (class_name + ".hpp");
-    fs::path source_path = dir_path / (class_name + ".cpp");
+  read_into_buffer(fd, cs_file_path, max_size, file.buffer);
+  if (file.buffer.empty()) {
+    throw input_error(cs_file_path, "is empty");
+  }
+  return file;
+}
 
-    return {header_path.string(), source_path.string()};
-  } catch (const fs::filesystem_error &e) {
-    throw IO_Exception(("Filesystem error: " + std::string(e.what())).c_str());
+void FileHandler::read_into_buffer(int fd, const std::string &cs_file_path,
+                                   std::size_t max_size, std::string &buffer) {
+  constexpr std::size_t CHUNK_SIZE = STREAM_BUFFER_SIZE;
+  std::size_t used = 0;
+  while (true) {
+    buffer.resize(used + CHUNK_SIZE);
+    ssize_t count = ::read(fd, buffer.data() + used, CHUNK_SIZE);
+    if (count < 0) {
+      if (errno == EINTR)
+        continue;
+      throw input_error(cs_file_path, "cannot be read: " +
+                                          std::string(std::strerror(errno)));
+    }
+    if (count == 0)
+      break;
+    used += static_cast<std::size_t>(count);
+    if (used > max_size) {
+      throw input_error(cs_file_path, "is larger than the " +
+                                          std::to_string(max_size) +
+                                          " byte limit");
+    }
   }
+  buffer.resize(used);
+}
+
+DescriptorOutputBuffer::DescriptorOutputBuffer(int fd, std::size_t buffer_size)
+    : fd(fd), buffer(buffer_size) {
+  setp(buffer.data(), buffer.data() + buffer.size());
 }
 
-std::ofstream FileHandler::open_output_stream(const std::string &file_path) {
-  std::ofstream os{file_path};
-  if (os.fail()) {
-    throw IO_Exception("Failed to open the output file stream");
+DescriptorOutputBuffer::~DescriptorOutputBuffer() { sync(); }
+
+DescriptorOutputBuffer::int_type DescriptorOutputBuffer::overflow(int_type ch) {
+  if (!flush_buffer()) {
+    return traits_type::eof();
+  }
+  if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+  }
+  return traits_type::not_eof(ch);
+}
+
+// Blocks at least as large as the buffer bypass it
+std::streamsize DescriptorOutputBuffer::xsputn(const char *data,
+                                               std::streamsize size) {
+  std::size_t count = static_cast<std::size_t>(size);
+  if (count < static_cast<std::size_t>(epptr() - pptr())) {
+    std::memcpy(pptr(), data, count);
+    pbump(static_cast<int>(count));
+    return size;
   }
-  return os;
+  if (!flush_buffer()) {
+    return 0;
+  }
+  if (count >= buffer.size()) {
+    return write_all(data, count) ? size : 0;
+  }
+  std::memcpy(pptr(), data, count);
+  pbump(static_cast<int>(count));
+  return size;
+}
+
+int DescriptorOutputBuffer::sync() { return flush_buffer() ? 0 : -1; }
+
+bool DescriptorOutputBuffer::flush_buffer() {
+  std::size_t pending = static_cast<std::size_t>(pptr() - pbase());
+  bool written = write_all(pbase(), pending);
+  setp(buffer.data(), buffer.data() + buffer.size());
+  return written;
 }
 
-void FileHandler::close_output_stream(std::ofstream &os) {
-  if (os.is_open()) {
-    os.close();
+bool DescriptorOutputBuffer::write_all(const char *data, std::size_t size) {
+  while (size > 0) {
+    ssize_t count = ::write(fd, data, size);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    data += count;
+    size -= static_cast<std::size_t>(count);
   }
+  return true;
 }
\ No newline at end of file
@@ -1,20 +1,84 @@
+#include <cstddef>
 #include <fstream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
 #ifndef FILE_HANDLER
 #define FILE_HANDLER
 
+// Largest input accepted by FileHandler::read_input_file (1 GiB)
+#define MAX_INPUT_FILE_SIZE (std::size_t{1} << 30)
+// Block size for reading pipes and writing standard output (1 MiB)
+#define STREAM_BUFFER_SIZE (std::size_t{1} << 20)
+
+// Read-only contents of an input file in one contiguous block. Regular files
+// are memory-mapped; pipes and other special files are read into a buffer.
+// The view stays valid for the lifetime of the object.
+class InputFile {
+public:
+  InputFile() = default;
+  ~InputFile();
+
+  InputFile(InputFile &&other) noexcept;
+  InputFile &operator=(InputFile &&other) noexcept;
+  InputFile(const InputFile &) = delete;
+  InputFile &operator=(const InputFile &) = delete;
+
+  std::string_view view() const;
+  bool is_mapped() const;
+
+private:
+  friend class FileHandler;
+
+  void *mapping = nullptr; // mmap()ed region, or nullptr when buffered
+  std::size_t mapping_size = 0;
+  std::string buffer;
+};
+
+// Stream buffer writing to a file descriptor (e.g. standard output) in
+// large blocks, bypassing stdio. Flushed on sync() and destruction.
+class DescriptorOutputBuffer : public std::streambuf {
+public:
+  explicit DescriptorOutputBuffer(int fd,
+                                  std::size_t buffer_size = STREAM_BUFFER_SIZE);
+  ~DescriptorOutputBuffer() override;
+
+protected:
+  int_type overflow(int_type ch) override;
+  std::streamsize xsputn(const char *data, std::streamsize size) override;
+  int sync() override;
+
+private:
+  int fd;
+  std::vector<char> buffer;
+
+  bool flush_buffer();
+  bool write_all(const char *data, std::size_t size);
+};
+
 class FileHandler {
 public:
   // For handling input file
   static std::ifstream create_input_stream(std::string cs_file_path);
   static int get_input_stream_char(std::istream *is);
+  // Throws IO_Exception for unreadable, empty or oversized (> max_size) files
+  static InputFile read_input_file(const std::string &cs_file_path,
+                                   std::size_t max_size = MAX_INPUT_FILE_SIZE);
+  // Same checks; mapped when standard input is redirected from a file
+  static InputFile
+  read_standard_input(std::size_t max_size = MAX_INPUT_FILE_SIZE);
+  // Same checks, for input received some other way (e.g. over a socket)
+  static InputFile
+  read_input_buffer(std::string contents, const std::string &cs_file_path,
+                    std::size_t max_size = MAX_INPUT_FILE_SIZE);
 
-  // For handling output files
-  static std::pair<std::string, std::string>
-  get_class_node_output_file_paths(const std::string &class_name);
-  static std::pair<std::string, std::string>
-  get_class_node_output_file_paths(const std::string &class_name, const std::string &directory_name);
-  static std::ofstream open_output_stream(const std::string &file_path);
-  static void close_output_stream(std::ofstream &os);
+private:
+  static InputFile read_input_descriptor(int fd,
+                                         const std::string &cs_file_path,
+                                         std::size_t max_size);
+  static void read_into_buffer(int fd, const std::string &cs_file_path,
+                               std::size_t max_size, std::string &buffer);
 };
 
 #endif
\ No newline at end of file
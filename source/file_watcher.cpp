@@ -0,0 +1,140 @@
+#include "file_watcher.hpp"
+#include "custom_exceptions.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+// Everything that can leave a file with new content, or remove it
+#define WATCHED_EVENTS                                                         \
+  (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE)
+
+static IO_Exception watch_error(const std::string &what) {
+  return IO_Exception((what + ": " + std::strerror(errno)).c_str());
+}
+
+FileWatcher::FileWatcher() {
+  inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd < 0) {
+    throw watch_error("Failed to initialise inotify");
+  }
+  if (::pipe2(stop_pipe, O_CLOEXEC) != 0) {
+    IO_Exception error = watch_error("Failed to create the watch stop pipe");
+    ::close(inotify_fd);
+    throw error;
+  }
+}
+
+FileWatcher::~FileWatcher() {
+  ::close(inotify_fd);
+  ::close(stop_pipe[0]);
+  ::close(stop_pipe[1]);
+}
+
+void FileWatcher::watch_directory(const std::string &directory) {
+  std::string path = std::filesystem::path(directory).lexically_normal().string();
+  if (path.size() > 1 && path.back() == '/') {
+    path.pop_back();
+  }
+  if (watched.count(path)) {
+    return;
+  }
+  int descriptor = ::inotify_add_watch(inotify_fd, path.c_str(),
+                                       WATCHED_EVENTS | IN_ONLYDIR);
+  if (descriptor < 0) {
+    throw watch_error("Failed to watch '" + path + "'");
+  }
+  directories[descriptor] = path;
+  watched.insert(path);
+}
+
+std::size_t FileWatcher::directory_count() const { return watched.size(); }
+
+std::vector<std::string>
+FileWatcher::wait_for_changes(std::chrono::milliseconds quiet_period) {
+  std::unordered_set<std::string> changed;
+  while (true) {
+    // Forever until the first change, then until a quiet period passes
+    Wait wait = wait_for_events(
+        changed.empty() ? -1 : static_cast<int>(quiet_period.count()));
+    if (wait == Wait::Stopped) {
+      return {};
+    }
+    if (wait == Wait::Quiet) {
+      break;
+    }
+    read_events(changed);
+  }
+
+  std::vector<std::string> paths(changed.begin(), changed.end());
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+void FileWatcher::stop() {
+  char byte = 0;
+  ssize_t ignored = ::write(stop_pipe[1], &byte, 1);
+  (void)ignored;
+}
+
+FileWatcher::Wait FileWatcher::wait_for_events(int timeout_ms) {
+  while (true) {
+    pollfd events[2] = {{stop_pipe[0], POLLIN, 0}, {inotify_fd, POLLIN, 0}};
+    int ready = ::poll(events, 2, timeout_ms);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw watch_error("Failed to wait for file changes");
+    }
+    if (events[0].revents) {
+      return Wait::Stopped;
+    }
+    return ready == 0 ? Wait::Quiet : Wait::Events;
+  }
+}
+
+void FileWatcher::read_events(std::unordered_set<std::string> &changed) {
+  alignas(inotify_event) char buffer[64 * 1024];
+  while (true) {
+    ssize_t length = ::read(inotify_fd, buffer, sizeof(buffer));
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN) {
+        return;
+      }
+      throw watch_error("Failed to read file changes");
+    }
+
+    for (char *position = buffer; position < buffer + length;) {
+      const inotify_event *event =
+          reinterpret_cast<const inotify_event *>(position);
+      position += sizeof(inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        changed.insert(watched.begin(), watched.end());
+        continue;
+      }
+      auto directory = directories.find(event->wd);
+      if (directory == directories.end()) {
+        continue;
+      }
+      if (event->mask & IN_IGNORED) { // Directory deleted or unmounted
+        watched.erase(directory->second);
+        directories.erase(directory);
+        continue;
+      }
+      if (event->len > 0) {
+        changed.insert((std::filesystem::path(directory->second) / event->name)
+                           .lexically_normal()
+                           .string());
+      }
+    }
+  }
+}
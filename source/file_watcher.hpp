@@ -0,0 +1,51 @@
+#ifndef FILE_WATCHER
+#define FILE_WATCHER
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Waits for files to change through Linux inotify. Directories are watched
+// rather than files, so that editors saving through a temporary file and a
+// rename (which replaces the watched inode) are still seen.
+class FileWatcher {
+public:
+  // Throws IO_Exception when inotify is not available
+  FileWatcher();
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher &) = delete;
+  FileWatcher &operator=(const FileWatcher &) = delete;
+
+  // Reports files written, created, renamed or deleted in the directory (not
+  // in its subdirectories). Watching a directory twice has no effect. When
+  // events were lost to a queue overflow, the directories themselves are
+  // reported as changed.
+  void watch_directory(const std::string &directory);
+  std::size_t directory_count() const;
+
+  // Blocks until something changes, then keeps collecting changes until
+  // none came for quiet_period, so that a burst of saves is reported once.
+  // Returns the changed paths, sorted; empty once stop() was called.
+  std::vector<std::string>
+  wait_for_changes(std::chrono::milliseconds quiet_period);
+
+  // Async-signal-safe, may be called from a signal handler or any thread
+  void stop();
+
+private:
+  int inotify_fd = -1;
+  int stop_pipe[2] = {-1, -1};
+  std::unordered_map<int, std::string> directories; // By watch descriptor
+  std::unordered_set<std::string> watched;
+
+  enum class Wait { Events, Quiet, Stopped };
+
+  // Waits at most timeout_ms, -1 meaning forever
+  Wait wait_for_events(int timeout_ms);
+  void read_events(std::unordered_set<std::string> &changed);
+};
+
+#endif
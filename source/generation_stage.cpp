@@ -0,0 +1,67 @@
+#include "generation_stage.hpp"
+#include "code_generator.hpp"
+#include "trace.hpp"
+#include <sstream>
+
+GeneratedClass GenerationStage::render_class(const ClassNode &class_node,
+                                             const GeneratorOptions &options) {
+  TraceSpan span("generate", "class", class_node.name);
+  std::ostringstream header_ss, source_ss;
+  CodeGenerator::generate_header(class_node, header_ss, options);
+  CodeGenerator::generate_source(class_node, source_ss, options);
+  return GeneratedClass{class_node.name, header_ss.str(), source_ss.str()};
+}
+
+GeneratedFiles GenerationStage::write_class(const GeneratedClass &generated,
+                                            OutputDirectory &directory) {
+  std::string header_name = generated.class_name + ".hpp";
+  std::string source_name = generated.class_name + ".cpp";
+
+  bool header_written =
+      directory.write_if_changed(header_name, generated.header);
+  bool source_written =
+      directory.write_if_changed(source_name, generated.source);
+
+  return GeneratedFiles{directory.file_path(header_name),
+                        directory.file_path(source_name), header_written,
+                        source_written};
+}
+
+std::vector<std::future<GeneratedClass>>
+GenerationStage::render_all(const std::vector<ClassNode> &class_nodes,
+                            const GeneratorOptions &options,
+                            ThreadPool &pool) {
+  std::vector<std::future<GeneratedClass>> pending;
+  pending.reserve(class_nodes.size());
+
+  for (const ClassNode &class_node : class_nodes) {
+    pending.push_back(pool.submit([&class_node, &options]() {
+      return render_class(class_node, options);
+    }));
+  }
+  return pending;
+}
+
+std::vector<std::future<GeneratedFiles>>
+GenerationStage::generate_all(const std::vector<ClassNode> &class_nodes,
+                              OutputDirectory &directory,
+                              const GeneratorOptions &options,
+                              ThreadPool &pool) {
+  std::vector<std::future<GeneratedFiles>> pending;
+  pending.reserve(class_nodes.size());
+
+  for (const ClassNode &class_node : class_nodes) {
+    pending.push_back(pool.submit([&class_node, &options, &directory]() {
+      return write_class(render_class(class_node, options), directory);
+    }));
+  }
+  return pending;
+}
+
+bool GenerationStage::write_hash_check(
+    const std::vector<ClassNode> &class_nodes,
+    const std::vector<std::string> &headers, OutputDirectory &directory) {
+  std::ostringstream check;
+  CodeGenerator::generate_hash_check(class_nodes, headers, check);
+  return directory.write_if_changed(HASH_CHECK_FILE_NAME, check.str());
+}
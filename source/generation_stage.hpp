@@ -0,0 +1,58 @@
+#ifndef GENERATION_STAGE
+#define GENERATION_STAGE
+
+#include "code_generator.hpp"
+#include "output_directory.hpp"
+#include "parser.hpp"
+#include "thread_pool.hpp"
+#include <future>
+#include <string>
+#include <vector>
+
+// Header and source of one class rendered into memory
+struct GeneratedClass {
+  std::string class_name;
+  std::string header;
+  std::string source;
+};
+
+// Paths of the files produced for one class. A file is not rewritten when
+// its content is unchanged.
+struct GeneratedFiles {
+  std::string header_path;
+  std::string source_path;
+  bool header_written = false;
+  bool source_written = false;
+};
+
+// Code generation for one class does not depend on any other class, so each
+// class is rendered into its own buffers and written out by a pool worker.
+class GenerationStage {
+public:
+  static GeneratedClass render_class(const ClassNode &class_node,
+                                     const GeneratorOptions &options);
+  static GeneratedFiles write_class(const GeneratedClass &generated,
+                                    OutputDirectory &directory);
+
+  // Writes the program checking hash/equality consistency of the classes
+  // declared in headers. Returns whether the file was written.
+  static bool write_hash_check(const std::vector<ClassNode> &class_nodes,
+                               const std::vector<std::string> &headers,
+                               OutputDirectory &directory);
+
+  // Renders every class on the pool without writing anything. One future
+  // per class, in the same order as class_nodes; the class nodes and
+  // options must outlive the returned futures.
+  static std::vector<std::future<GeneratedClass>>
+  render_all(const std::vector<ClassNode> &class_nodes,
+             const GeneratorOptions &options, ThreadPool &pool);
+
+  // One future per class, in the same order as class_nodes. The class
+  // nodes, directory and options must outlive the returned futures.
+  static std::vector<std::future<GeneratedFiles>>
+  generate_all(const std::vector<ClassNode> &class_nodes,
+               OutputDirectory &directory,
+               const GeneratorOptions &options, ThreadPool &pool);
+};
+
+#endif
@@ -0,0 +1,23 @@
+#include "hash_utils.hpp"
+
+static constexpr std::uint64_t FNV_PRIME = 1099511628211ULL;
+
+std::uint64_t HashUtils::fnv1a_64(std::string_view data,
+                                  std::uint64_t seed) {
+  std::uint64_t hash = seed;
+  for (unsigned char byte : data) {
+    hash ^= byte;
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+std::string HashUtils::to_hex(std::uint64_t value) {
+  static const char digits[] = "0123456789abcdef";
+  std::string hex(16, '0');
+  for (int i = 15; i >= 0; i--) {
+    hex[i] = digits[value & 0xF];
+    value >>= 4;
+  }
+  return hex;
+}
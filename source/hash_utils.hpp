@@ -0,0 +1,19 @@
+#ifndef HASH_UTILS
+#define HASH_UTILS
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Non-cryptographic hashing of generated content (FNV-1a, 64 bits). Stable
+// across platforms and standard libraries, unlike std::hash.
+class HashUtils {
+public:
+  static constexpr std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+
+  static std::uint64_t fnv1a_64(std::string_view data,
+                                std::uint64_t seed = FNV_OFFSET_BASIS);
+  static std::string to_hex(std::uint64_t value);
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "incremental_converter.hpp"
+#include "field_layout.hpp"
+#include "file_handler.hpp"
+#include "generation_stage.hpp"
+#include "hash_utils.hpp"
+#include "lexer.hpp"
+#include "output_directory.hpp"
+#include "output_manifest.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include "unity_builder.hpp"
+#include "validator.hpp"
+#include <exception>
+
+IncrementalConverter::IncrementalConverter(const ProgramOptions &options)
+    : options(options) {}
+
+IncrementalUpdate IncrementalConverter::add(const BatchInput &input) {
+  TrackedFile &file = files[input.path];
+  file = TrackedFile{};
+  file.input = input;
+  return convert(file);
+}
+
+IncrementalUpdate IncrementalConverter::refresh(const std::string &path) {
+  return convert(files.at(path));
+}
+
+void IncrementalConverter::forget(const std::string &path) {
+  files.erase(path);
+}
+
+bool IncrementalConverter::tracks(const std::string &path) const {
+  return files.count(path) != 0;
+}
+
+std::size_t IncrementalConverter::file_count() const { return files.size(); }
+
+IncrementalUpdate IncrementalConverter::convert(TrackedFile &file) {
+  TraceSpan span("convert", "file", file.input.path);
+  auto start = std::chrono::steady_clock::now();
+  IncrementalUpdate update;
+  update.path = file.input.path;
+
+  try {
+    InputFile source = FileHandler::read_input_file(file.input.path);
+    std::uint64_t source_digest = HashUtils::fnv1a_64(source.view());
+    if (file.converted && source_digest == file.source_digest) {
+      update.source_unchanged = true;
+      update.duration = std::chrono::steady_clock::now() - start;
+      return update;
+    }
+
+    Lexer lexer(source.view());
+    Parser parser(lexer);
+    std::vector<ClassNode> class_nodes = parser.parseProgram();
+    Validator::ensure_valid_structure(class_nodes);
+
+    std::map<std::string, std::uint64_t> class_digests;
+    for (const ClassNode &class_node : class_nodes) {
+      class_digests[class_node.name] = class_digest(class_node);
+    }
+
+    GeneratorOptions generator = options.generator;
+    ClassLayouts packed_layouts;
+    if (generator.pack_fields) {
+      packed_layouts = FieldLayout::compute_class_layouts(class_nodes, true);
+      generator.class_layouts = &packed_layouts;
+    }
+    bool whole_file =
+        !file.converted || options.unity_units || generator.pack_fields;
+
+    OutputDirectory output(file.input.output_directory, options.durability);
+    std::vector<std::string> headers;
+    if (options.unity_units) {
+      ThreadPool inline_pool(0);
+      UnityBuilder::write(UnityBuilder::build(class_nodes,
+                                              options.unity_units,
+                                              generator, inline_pool),
+                          output);
+      headers.push_back(UNITY_HEADER_NAME);
+      update.classes_generated = class_nodes.size();
+    } else {
+      for (const ClassNode &class_node : class_nodes) {
+        headers.push_back(class_node.name + ".hpp");
+        auto previous = file.class_digests.find(class_node.name);
+        if (!whole_file && previous != file.class_digests.end() &&
+            previous->second == class_digests[class_node.name]) {
+          output.keep(class_node.name + ".hpp");
+          output.keep(class_node.name + ".cpp");
+          update.classes_unchanged++;
+          continue;
+        }
+        GenerationStage::write_class(
+            GenerationStage::render_class(class_node, generator), output);
+        update.classes_generated++;
+      }
+      for (const auto &[class_name, digest] : file.class_digests) {
+        if (!class_digests.count(class_name)) {
+          output.remove(class_name + ".hpp");
+          output.remove(class_name + ".cpp");
+          update.classes_removed++;
+        }
+      }
+    }
+    if (generator.hash_support) {
+      GenerationStage::write_hash_check(class_nodes, headers, output);
+    }
+    ManifestFile::update(output,
+                         ManifestFile::inputs(file.input.path, options));
+    output.commit();
+    update.files_written = output.stats().files_written;
+
+    file.converted = true;
+    file.source_digest = source_digest;
+    file.class_nodes = std::move(class_nodes);
+    file.class_digests = std::move(class_digests);
+  } catch (const std::exception &e) {
+    update.error = e.what();
+  }
+
+  update.duration = std::chrono::steady_clock::now() - start;
+  return update;
+}
+
+// Everything code generation reads from a class; '\0' separates the parts
+// so that different splits of the same characters differ
+std::uint64_t IncrementalConverter::class_digest(const ClassNode &class_node) {
+  std::string text;
+  auto add = [&text](const std::string &part) {
+    text += part;
+    text += '\0';
+  };
+  auto add_access = [&add](const std::optional<AccessModifier> &access) {
+    add(access ? std::to_string(static_cast<int>(*access)) : "-");
+  };
+
+  add(class_node.name);
+  add(class_node.base_class.value_or("-"));
+  add_access(class_node.access);
+  for (const FieldNode &field : class_node.fields) {
+    add("field");
+    add_access(field.access);
+    add(field.type);
+    add(field.name);
+  }
+  for (const PropertyNode &property : class_node.properties) {
+    add("property");
+    add_access(property.access);
+    add(property.type);
+    add(property.name);
+    for (const PropertyAcessor &accessor : property.accessors) {
+      add(accessor.operation + (accessor.has_brackets ? "{}" : ""));
+    }
+  }
+  for (const MethodNode &method : class_node.methods) {
+    add("method");
+    add_access(method.access);
+    add(method.return_type.value_or("-"));
+    add(method.name);
+    add(std::string(method.is_override ? "override" : "") +
+        (method.is_constructor ? "constructor" : ""));
+    for (const MethodParam &parameter : method.parameters) {
+      add(parameter.type);
+      add(parameter.name);
+    }
+  }
+  return HashUtils::fnv1a_64(text);
+}
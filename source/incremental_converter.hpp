@@ -0,0 +1,61 @@
+#ifndef INCREMENTAL_CONVERTER
+#define INCREMENTAL_CONVERTER
+
+#include "batch_converter.hpp"
+#include "options.hpp"
+#include "parser.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// What one conversion of a watched file did
+struct IncrementalUpdate {
+  std::string path;
+  bool source_unchanged = false;   // Saved without changes, nothing done
+  std::size_t classes_generated = 0;
+  std::size_t classes_unchanged = 0; // Same AST as before, not rendered
+  std::size_t classes_removed = 0;   // Their files were deleted
+  std::size_t files_written = 0;
+  std::string error; // Set when the new content failed, output is kept
+  std::chrono::steady_clock::duration duration{};
+};
+
+// Keeps the validated AST of every tracked file between conversions. When a
+// file changes only that file is lexed, parsed and validated again, and only
+// its classes whose AST changed are rendered; files of classes that
+// disappeared are deleted. Packed layouts and unity builds depend on every
+// class of the file, so those regenerate the whole file.
+class IncrementalConverter {
+public:
+  explicit IncrementalConverter(const ProgramOptions &options);
+
+  // Converts a file completely and starts tracking it
+  IncrementalUpdate add(const BatchInput &input);
+  // Converts what changed in a tracked file since its last conversion
+  IncrementalUpdate refresh(const std::string &path);
+  // Stops tracking a file (e.g. deleted), its output is left as it is
+  void forget(const std::string &path);
+
+  bool tracks(const std::string &path) const;
+  std::size_t file_count() const;
+
+private:
+  struct TrackedFile {
+    BatchInput input;
+    bool converted = false;
+    std::uint64_t source_digest = 0;
+    std::vector<ClassNode> class_nodes; // Validated
+    std::map<std::string, std::uint64_t> class_digests; // By class name
+  };
+
+  ProgramOptions options;
+  std::map<std::string, TrackedFile> files; // By input path
+
+  IncrementalUpdate convert(TrackedFile &file);
+  static std::uint64_t class_digest(const ClassNode &class_node);
+};
+
+#endif
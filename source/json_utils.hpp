@@ -0,0 +1,14 @@
+#ifndef JSON_UTILS
+#define JSON_UTILS
+
+#include <ostream>
+#include <string_view>
+
+// Pieces of the JSON written by --stats=json and --trace
+class JsonUtils {
+public:
+  // Quoted, with quotes, backslashes and control characters escaped
+  static void write_string(std::ostream &out, std::string_view value);
+};
+
+#endif
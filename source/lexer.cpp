@@ -2,16 +2,36 @@
 #include "custom_exceptions.hpp"
 #include "file_handler.hpp"
 #include <cctype>
+#include <chrono>
+#include <cstdio>
 #include <unordered_set>
+#include <iterator>
 #include <sstream>
 
 Lexer::Lexer(std::istream *input)
-    : input(input), has_peeked(false), line(1), column(0) {
+    : owned_source(std::make_shared<const std::string>(
+          std::istreambuf_iterator<char>(*input),
+          std::istreambuf_iterator<char>())),
+      source(*owned_source), has_peeked(false), line(1), column(0) {
   advance();
 }
 
+Lexer::Lexer(std::string_view source)
+    : source(source), has_peeked(false), line(1), column(0) {
+  advance();
+}
+
+// Next source character, or EOF once the source is exhausted
+int Lexer::read_char() {
+  if (position < source.size()) {
+    return static_cast<unsigned char>(source[position++]);
+  }
+  at_end = true;
+  return EOF;
+}
+
 void Lexer::advance() {
-  current_char = input->get();
+  current_char = read_char();
   if (current_char == '\n') {
     column = 0;
     line++;
@@ -46,9 +66,29 @@ Token Lexer::next_token() {
   return next_token_internal();
 }
 
-bool Lexer::has_more_tokens() { return !input->eof(); }
+bool Lexer::has_more_tokens() { return !at_end; }
+
+static std::uint64_t nanoseconds_since(
+    std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+void Lexer::collect_stats(LexerStats *stats) { this->stats = stats; }
 
 Token Lexer::next_token_internal() {
+  if (!stats) {
+    return lex_token();
+  }
+  auto start = std::chrono::steady_clock::now();
+  Token token = lex_token();
+  stats->nanoseconds += nanoseconds_since(start);
+  stats->tokens++;
+  return token;
+}
+
+Token Lexer::lex_token() {
   skip_whitespace();
 
   if (std::isalpha(current_char) || current_char == '_') {
@@ -61,7 +101,7 @@ Token Lexer::next_token_internal() {
         column);
   }
 
-  if (input->eof()) {
+  if (at_end) {
     return Token{TokenType::EndOfFile, ""};
   }
 
@@ -117,10 +157,12 @@ bool Lexer::is_recognize_symbol(const char &symbol) {
 }
 
 void Lexer::skipBracedBlock() {
+  auto start = stats ? std::chrono::steady_clock::now()
+                     : std::chrono::steady_clock::time_point{};
   int braceCount = 1; // Assume '{' already consumed before calling this
 
   while (braceCount > 0) {
-    char c = input->get();
+    char c = read_char();
     if (c == '\n') {
       column = 0;
       line++;
@@ -128,7 +170,7 @@ void Lexer::skipBracedBlock() {
       column++;
     }
 
-    if (input->eof()) {
+    if (at_end) {
       throw Parser_Exception("Unexpected EOF while skipping braced block", line,
                              column);
     }
@@ -141,7 +183,10 @@ void Lexer::skipBracedBlock() {
     // Otherwise just skip the character regardless of what it is
   }
 
-  current_char = input->get();
+  current_char = read_char();
+  if (stats) {
+    stats->nanoseconds += nanoseconds_since(start);
+  }
 }
 
 void Lexer::falsify_peek_flag(){
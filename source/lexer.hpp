@@ -1,7 +1,11 @@
 #ifndef LEXER_HPP
 #define LEXER_HPP
 
+#include <cstdint>
+#include <istream>
+#include <memory>
 #include <string>
+#include <string_view>
 
 enum class TokenType { Keyword, Identifier, Symbol, EndOfFile };
 
@@ -10,9 +14,18 @@ struct Token {
   std::string value;
 };
 
+// Work done by a lexer, collected only when asked for (see --stats)
+struct LexerStats {
+  std::uint64_t tokens = 0;
+  std::uint64_t nanoseconds = 0; // Producing tokens and skipping bodies
+};
+
 class Lexer {
 public:
+  // Reads the whole stream into a buffer shared by copies of the lexer
   Lexer(std::istream *input);
+  // Lexes the view in place, it must outlive the lexer (and its copies)
+  explicit Lexer(std::string_view source);
   Token next_token();
   Token post_skip();
   Token peek_token();
@@ -27,11 +40,19 @@ public:
   char get_current_char();
   void skipBracedBlock();
 
+  // Counts tokens and lexing time into stats from now on; copies of the
+  // lexer share it. Without it the only cost is a null check per token.
+  void collect_stats(LexerStats *stats);
+
 private:
-  std::istream *input;
+  std::shared_ptr<const std::string> owned_source;
+  std::string_view source;
+  std::size_t position = 0;
+  bool at_end = false; // A read went past the end of the source
   char current_char;
   bool has_peeked;
   Token peeked_token;
+  LexerStats *stats = nullptr;
 
   int line = 1;
   int column = 0;
@@ -39,8 +60,10 @@ private:
   int column_before_identifier_or_keyword = 0;
 
   void advance();
+  int read_char();
   void skip_whitespace();
   Token next_token_internal();
+  Token lex_token();
 
   Token parse_identifier_or_keyword();
   Token parse_symbol();
@@ -1,89 +1,890 @@
 
+#include <chrono>
+#include <csignal>
 #include <cstring>
+#include <fcntl.h>
+#include <filesystem>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <unordered_map>
+#include <unistd.h>
 #include <vector>
 
+#include "ast_cache.hpp"
+#include "batch_converter.hpp"
+#include "bundle.hpp"
 #include "code_generator.hpp"
+#include "conversion_server.hpp"
 #include "custom_exceptions.hpp"
+#include "field_layout.hpp"
+#include "file_watcher.hpp"
 #include "file_handler.hpp"
+#include "generation_stage.hpp"
+#include "hash_utils.hpp"
+#include "incremental_converter.hpp"
 #include "lexer.hpp"
+#include "name_transformer.hpp"
+#include "options.hpp"
+#include "run_stats.hpp"
+#include "output_directory.hpp"
+#include "output_manifest.hpp"
 #include "parser.hpp"
+#include "result_cache.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include "type_table.hpp"
+#include "unity_builder.hpp"
 #include "validator.hpp"
+#include "work_stealing_pool.hpp"
 
 #define OUTPUT_DIRECTORY "results"
 
-int main(int argc, char *argv[]) {
+// Renders every class twice in independent passes and fails if the two
+// passes differ. Returns a digest of the output so that runs on different
+// machines or toolchains can be compared.
+static std::uint64_t
+verify_reproducible_output(const std::vector<ClassNode> &class_nodes,
+                           const GeneratorOptions &options) {
+  std::uint64_t digests[2];
 
-  if (argc == 1 || argc > 2) {
-    std::cerr << "To run the program you need to provide the .cs file path "
-                 "through the command line. Ex.: \"./main example.cs\". \n";
-    return EXIT_FAILURE;
+  for (std::uint64_t &digest : digests) {
+    digest = HashUtils::FNV_OFFSET_BASIS;
+    for (const ClassNode &class_node : class_nodes) {
+      GeneratedClass generated =
+          GenerationStage::render_class(class_node, options);
+      digest = HashUtils::fnv1a_64(generated.class_name, digest);
+      digest = HashUtils::fnv1a_64(generated.header, digest);
+      digest = HashUtils::fnv1a_64(generated.source, digest);
+    }
   }
 
-  std::string cs_file_path{argv[1]};
+  if (digests[0] != digests[1]) {
+    throw Code_Generation_Exception(
+        "Generated output differs between two passes over the same input");
+  }
+  return digests[0];
+}
 
-  if (cs_file_path.length() <= 3 ||
-      cs_file_path.substr(cs_file_path.length() - 3, 3) != ".cs") {
-    std::cerr << "Must provide a .cs file path. This program only works for C# "
-                 "files. \n";
-    return EXIT_FAILURE;
+static double to_milliseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Printed, or written to --stats-file, once the run is over
+static void report_stats(const RunStats &stats,
+                         const ProgramOptions &options) {
+  if (options.stats == StatsFormat::None) {
+    return;
+  }
+  std::ofstream file;
+  if (!options.stats_path.empty()) {
+    file.open(options.stats_path, std::ios::trunc);
+    if (file.fail()) {
+      throw IO_Exception(("Failed to open the stats file '" +
+                          options.stats_path + "'")
+                             .c_str());
+    }
+  }
+  std::ostream &out = options.stats_path.empty() ? std::cout : file;
+  if (options.stats == StatsFormat::Json) {
+    stats.write_json(out);
+  } else {
+    stats.write_text(out);
+  }
+}
+
+// Written once the run is over, when every pool thread has been joined
+static void write_trace(const std::string &trace_path) {
+  std::ofstream file(trace_path, std::ios::trunc);
+  Trace::write_json(file);
+  file.close();
+  if (file.fail()) {
+    throw IO_Exception(
+        ("Failed to write the trace file '" + trace_path + "'").c_str());
+  }
+}
+
+// Lists the outputs in the manifest, removing stale ones, makes them durable
+// and writes the depfile
+static void finish_output(OutputDirectory &output,
+                          const ProgramOptions &options) {
+  ManifestUpdate manifest = ManifestFile::update(
+      output, ManifestFile::inputs(options.cs_file_path, options));
+  if (options.verbosity >= Verbosity::Classes) {
+    for (const std::string &file_name : manifest.stale_files) {
+      std::cout << "Removed stale file: " << output.file_path(file_name)
+                << "\n";
+    }
+  }
+  if (options.verbosity >= Verbosity::Summary &&
+      !manifest.stale_files.empty()) {
+    std::cout << "Stale files removed: " << manifest.stale_files.size()
+              << "\n";
+  }
+  output.commit();
+  if (!options.depfile_path.empty()) {
+    std::ostringstream rule;
+    ManifestFile::write_depfile_rule(
+        rule, ManifestFile::targets(output.name(), manifest.manifest),
+        manifest.manifest.inputs);
+    ManifestFile::write_depfile(options.depfile_path, rule.str());
+  }
+}
+
+// Streams every generated file into one bundle, in class order, while the
+// pool renders the classes. Returns the number of bundled files.
+static std::size_t write_bundle(const std::vector<ClassNode> &class_nodes,
+                                const ProgramOptions &options,
+                                ThreadPool &pool, std::ostream &output,
+                                RunStats &stats) {
+  TraceSpan span("bundle", "file", options.bundle_path);
+  BundleWriter bundle(output);
+  std::vector<std::string> headers;
+
+  if (options.unity_units) {
+    UnityOutput unity = UnityBuilder::build(class_nodes, options.unity_units,
+                                            options.generator, pool);
+    bundle.add(UNITY_HEADER_NAME, unity.header);
+    for (std::size_t i = 0; i < unity.units.size(); i++) {
+      bundle.add(UnityBuilder::unit_file_name(i), unity.units[i]);
+    }
+    headers.push_back(UNITY_HEADER_NAME);
+  } else {
+    for (std::future<GeneratedClass> &result :
+         GenerationStage::render_all(class_nodes, options.generator, pool)) {
+      GeneratedClass generated = result.get();
+      bundle.add(generated.class_name + ".hpp", generated.header);
+      bundle.add(generated.class_name + ".cpp", generated.source);
+      headers.push_back(generated.class_name + ".hpp");
+    }
+  }
+
+  if (options.generator.hash_support) {
+    std::ostringstream check;
+    CodeGenerator::generate_hash_check(class_nodes, headers, check);
+    bundle.add(HASH_CHECK_FILE_NAME, check.str());
+  }
+  bundle.finish();
+  stats.count_files(bundle.entry_count(), 0, bundle.bytes_written());
+  return bundle.entry_count();
+}
+
+// Written next to its final name and renamed into place once complete
+static std::size_t write_bundle_file(const std::vector<ClassNode> &class_nodes,
+                                     const ProgramOptions &options,
+                                     ThreadPool &pool, RunStats &stats) {
+  std::string temporary_path = options.bundle_path + ".tmp";
+  std::vector<char> buffer(1 << 20);
+  std::ofstream file;
+  file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+  file.open(temporary_path, std::ios::binary | std::ios::trunc);
+  if (file.fail()) {
+    throw IO_Exception(
+        ("Failed to open the bundle file '" + temporary_path + "'").c_str());
+  }
+
+  std::error_code error;
+  try {
+    std::size_t files =
+        write_bundle(class_nodes, options, pool, file, stats);
+    file.close();
+    std::filesystem::rename(temporary_path, options.bundle_path, error);
+    if (file.fail() || error) {
+      throw IO_Exception(("Failed to write the bundle file '" +
+                          options.bundle_path + "'")
+                             .c_str());
+    }
+    return files;
+  } catch (...) {
+    std::filesystem::remove(temporary_path, error);
+    throw;
+  }
+}
+
+// Converts every input into its own directory under output/. Returns the
+// exit status: failures are reported together once all files were tried.
+static int run_batch(const ProgramOptions &options, RunStats &stats) {
+  BatchPlan plan = BatchConverter::plan(options.input_paths, "output");
+  for (const BatchInput &input : plan.inputs) {
+    stats.count_input(input.size);
+  }
+  stats.end_phase("find inputs");
+
+  std::unique_ptr<ResultCache> cache;
+  if (!options.cache_directory.empty()) {
+    cache = std::make_unique<ResultCache>(options.cache_directory,
+                                          options.cache_limit_mib << 20,
+                                          ResultCache::fingerprint(options));
+  }
+  WorkStealingPool pool(options.jobs ? options.jobs
+                                     : ThreadPool::default_worker_count());
+  BatchResult result =
+      BatchConverter::convert_all(plan, options, pool, cache.get());
+  stats.end_phase("convert on " + std::to_string(pool.size()) + " workers");
+  stats.count_classes(result.classes, result.members);
+  stats.count_files(result.files_written, result.files_unchanged,
+                    result.bytes_written);
+  if (cache) {
+    stats.count_cache(cache->stats());
+  }
+
+  std::size_t input_count = plan.inputs.size() + plan.failures.size();
+  if (options.verbosity >= Verbosity::Summary) {
+    std::cout << "Converted " << result.converted_files << " of "
+              << input_count << " files (" << result.classes
+              << " classes) on " << pool.size() << " workers, "
+              << pool.steal_count() << " stolen\n"
+              << "Files written: " << result.files_written
+              << ", unchanged and skipped: " << result.files_unchanged
+              << ", stale and removed: " << result.stale_files_removed
+              << "\n";
+    if (cache) {
+      ResultCacheStats cached = cache->stats();
+      std::cout << "Result cache: " << cached.hits << " hits, "
+                << cached.misses << " misses, " << cached.stores
+                << " stored, " << cached.evictions << " evicted\n";
+    }
+  }
+  if (!options.depfile_path.empty()) {
+    std::ostringstream rules;
+    for (const BatchOutput &output : result.outputs) {
+      ManifestFile::write_depfile_rule(
+          rules,
+          ManifestFile::targets(output.output_directory, output.manifest),
+          output.manifest.inputs);
+    }
+    ManifestFile::write_depfile(options.depfile_path, rules.str());
+  }
+  for (const BatchFailure &failure : result.failures) {
+    std::cerr << "Failed to convert " << failure.path << ": "
+              << failure.message << "\n";
+  }
+  report_stats(stats, options);
+  return result.failures.empty() ? 0 : EXIT_FAILURE;
+}
+
+static void print_update(const IncrementalUpdate &update,
+                         Verbosity verbosity) {
+  if (!update.error.empty()) {
+    std::cerr << "Failed to convert " << update.path << ": " << update.error
+              << "\n";
+    return;
+  }
+  if (update.source_unchanged || verbosity < Verbosity::Summary) {
+    return;
+  }
+  std::cout << "Converted " << update.path << ": "
+            << update.classes_generated << " classes generated, "
+            << update.classes_unchanged << " unchanged, "
+            << update.classes_removed << " removed, " << update.files_written
+            << " files written in " << to_milliseconds(update.duration)
+            << " ms" << std::endl;
+}
+
+// The directories holding the input files, and every directory below an
+// input directory so that new files are found
+static void watch_inputs(const std::vector<std::string> &input_paths,
+                         FileWatcher &watcher) {
+  namespace fs = std::filesystem;
+  for (const std::string &input_path : input_paths) {
+    if (!fs::is_directory(input_path)) {
+      fs::path parent = fs::path(input_path).parent_path();
+      watcher.watch_directory(parent.empty() ? "." : parent.string());
+      continue;
+    }
+    watcher.watch_directory(input_path);
+    std::error_code error;
+    for (fs::recursive_directory_iterator
+             it(input_path, fs::directory_options::skip_permission_denied,
+                error),
+         end;
+         !error && it != end; it.increment(error)) {
+      std::error_code type_error;
+      if (it->is_directory(type_error)) {
+        watcher.watch_directory(it->path().string());
+      }
+    }
+  }
+}
+
+static FileWatcher *running_watcher = nullptr;
+
+static void stop_running_watcher(int) { running_watcher->stop(); }
+
+// Converts every input once, then again whenever it changes: only the
+// changed file is parsed again and only its changed classes regenerated
+static int run_watch(const ProgramOptions &options) {
+  namespace fs = std::filesystem;
+  IncrementalConverter converter(options);
+  FileWatcher watcher;
+
+  bool first_plan = true;
+  auto track_new_files = [&]() {
+    BatchPlan plan =
+        options.batch
+            ? BatchConverter::plan(options.input_paths, "output")
+            : BatchPlan{{BatchInput{options.cs_file_path, "output", 0}}, {}};
+    // Same spelling as the paths reported by the watcher
+    for (BatchInput &input : plan.inputs) {
+      input.path = fs::path(input.path).lexically_normal().string();
+      if (!converter.tracks(input.path)) {
+        print_update(converter.add(input), options.verbosity);
+      }
+    }
+    for (const BatchFailure &failure : plan.failures) {
+      if (first_plan) {
+        std::cerr << "Failed to convert " << failure.path << ": "
+                  << failure.message << "\n";
+      }
+    }
+    first_plan = false;
+    watch_inputs(options.input_paths, watcher);
+  };
+  track_new_files();
+
+  running_watcher = &watcher;
+  std::signal(SIGINT, stop_running_watcher);
+  std::signal(SIGTERM, stop_running_watcher);
+  if (options.verbosity >= Verbosity::Summary) {
+    std::cout << "Watching " << converter.file_count() << " files in "
+              << watcher.directory_count() << " directories, Ctrl-C to stop"
+              << std::endl;
+  }
+
+  std::vector<std::string> changed;
+  while (!(changed = watcher.wait_for_changes(std::chrono::milliseconds(
+               options.debounce_milliseconds)))
+              .empty()) {
+    bool new_inputs = false;
+    for (const std::string &path : changed) {
+      std::error_code error;
+      bool exists = fs::exists(path, error);
+      if (converter.tracks(path) && exists) {
+        print_update(converter.refresh(path), options.verbosity);
+      } else if (converter.tracks(path)) {
+        converter.forget(path);
+        if (options.verbosity >= Verbosity::Summary) {
+          std::cout << "Stopped tracking " << path << " (removed)"
+                    << std::endl;
+        }
+      } else if (exists && (fs::is_directory(path, error) ||
+                            fs::path(path).extension() == ".cs")) {
+        new_inputs = true;
+      }
+    }
+    if (new_inputs) {
+      track_new_files();
+    }
+    NameTransformer::trim_caches();
+  }
+
+  std::signal(SIGINT, SIG_DFL);
+  std::signal(SIGTERM, SIG_DFL);
+  running_watcher = nullptr;
+  return 0;
+}
+
+// Formatted into memory and written at once: printing class by class to a
+// terminal or CI log costs more than the conversion on large inputs
+static void print_ast_dump(const std::vector<ClassNode> &class_nodes) {
+  std::ostringstream dump;
+  dump << "---------------- CLASS NODES ------------------\n\n";
+  for (std::size_t i = 0; i < class_nodes.size(); i++) {
+    dump << i + 1 << " ------------------\n"
+         << class_nodes[i] << "\n------------------\n";
+  }
+  std::cout << dump.str();
+}
+
+static void print_layout_report(const std::vector<ClassNode> &class_nodes) {
+  std::cout << "Packed field layout (estimated sizeof):\n";
+  for (const LayoutReport &report : FieldLayout::report(class_nodes)) {
+    std::cout << "- " << report.class_name << ": " << report.declared_size
+              << " -> " << report.packed_size << " bytes (saved "
+              << static_cast<std::ptrdiff_t>(report.declared_size) -
+                     static_cast<std::ptrdiff_t>(report.packed_size)
+              << ")\n";
+  }
+  std::cout << "\n";
+}
+
+// Where run_conversion finds standard input and writes a bundle for "-",
+// and the state a conversion server keeps between runs
+struct ConversionSession {
+  const std::string *standard_input = nullptr; // File descriptor 0 when null
+  std::ostream *standard_output = nullptr;     // File descriptor 1 when null
+  AstCache *ast_cache = nullptr;               // Always parsed when null
+  std::string type_map_identity; // Installed type mappings, for cache keys
+};
+
+static int run_conversion(ProgramOptions options, ConversionSession &session) {
+  // With the bundle on standard output, all messages go to standard error
+  if (options.bundle_path == "-") {
+    std::cout.rdbuf(std::cerr.rdbuf());
   }
 
   // After all checks on program call, may proceed with program logic
 
   try {
-    std::ifstream input_file_stream =
-        FileHandler::create_input_stream(cs_file_path);
+    RunStats stats(options.stats != StatsFormat::None);
+
+    // Loaded once, before anything queries the table; the server has
+    // installed it already
+    if (!options.type_map_path.empty() &&
+        session.type_map_identity.empty()) {
+      TypeTable::install(TypeTable::load(options.type_map_path));
+      if (options.verbosity >= Verbosity::Summary) {
+        std::cout << "Loaded " << TypeTable::active().size()
+                  << " type mappings from " << options.type_map_path
+                  << "\n\n";
+      }
+    }
+
+    if (options.watch) {
+      return run_watch(options);
+    }
+    if (options.batch) {
+      return run_batch(options, stats);
+    }
+    TraceSpan span("convert", "file", options.cs_file_path);
+
+    // Mapped (or buffered) input, lexed in place; must outlive the parser
+    InputFile input_file =
+        options.cs_file_path != "-"
+            ? FileHandler::read_input_file(options.cs_file_path)
+        : session.standard_input
+            ? FileHandler::read_input_buffer(*session.standard_input,
+                                             "<stdin>")
+            : FileHandler::read_standard_input();
+    stats.count_input(input_file.view().size());
 
-    Lexer lexer(&input_file_stream);
-    Parser parser(lexer);
-    std::vector<ClassNode> class_nodes = parser.parseProgram();
+    const bool summary = options.verbosity >= Verbosity::Summary;
+    const bool per_class = options.verbosity >= Verbosity::Classes;
 
-    std::cout << "---------------- CLASS NODES ------------------\n\n";
-    for (long unsigned int i = 0; i < class_nodes.size(); i++) {
-      std::cout << i + 1 << " ------------------\n"
-                << class_nodes[i] << "\n------------------\n";
+    // Output sets of earlier runs (of any process) on the same input with
+    // the same options; bundles are always generated
+    std::unique_ptr<ResultCache> result_cache;
+    std::string result_key;
+    if (!options.cache_directory.empty() && options.bundle_path.empty() &&
+        !options.reproducible) {
+      result_cache = std::make_unique<ResultCache>(
+          options.cache_directory, options.cache_limit_mib << 20,
+          ResultCache::fingerprint(options));
+      result_key = result_cache->key(input_file.view());
+      OutputDirectory output("output", options.durability);
+      CachedConversion cached;
+      if (result_cache->restore(result_key, input_file.view(), output,
+                                cached)) {
+        if (per_class) {
+          std::cout << "Restored from the result cache: \n";
+          for (const std::string &file_name : output.file_names()) {
+            std::cout << "-" << output.file_path(file_name) << "\n";
+          }
+          std::cout << "\n";
+        }
+        if (summary) {
+          OutputDirectoryStats restored = output.stats();
+          std::cout << "Restored " << cached.classes
+                    << " classes from the result cache. Files linked: "
+                    << restored.files_written
+                    << ", unchanged and skipped: " << restored.files_unchanged
+                    << "\n";
+        }
+        finish_output(output, options);
+        stats.end_phase("read and restore from cache");
+        stats.count_classes(cached.classes, cached.members);
+        stats.count_output(output.stats());
+        stats.count_cache(result_cache->stats());
+        report_stats(stats, options);
+        return 0;
+      }
     }
-    std::cout << "Full AST Tree constructed!\n";
 
-    std::cout << "---------------- VALIDATION ------------------\n\n";
-    Validator::ensure_valid_structure(class_nodes);
-    std::cout << "All classes valid!\n";
+    AstCache::ClassNodes validated_nodes;
+    if (session.ast_cache) {
+      validated_nodes = session.ast_cache->find(input_file.view(),
+                                                session.type_map_identity);
+    }
 
-    std::cout << "---------------- CODE GENERATION ------------------\n\n";
+    if (validated_nodes) {
+      if (summary) {
+        std::cout << "Reusing the validated AST of an identical input\n";
+      }
+      stats.end_phase("read and reuse cached AST");
+    } else {
+      Lexer lexer(input_file.view());
+      lexer.collect_stats(stats.lexer_stats());
+      Parser parser(lexer);
+      std::vector<ClassNode> parsed_nodes = parser.parseProgram();
+      stats.end_phase("read, lex and parse");
 
-    for (ClassNode &class_node : class_nodes) {
-      auto [header_path, source_path] =
-          FileHandler::get_class_node_output_file_paths(class_node.name,
-                                                        "output");
+      if (options.verbosity >= Verbosity::Ast) {
+        print_ast_dump(parsed_nodes);
+      }
+      if (summary) {
+        std::cout << "Full AST Tree constructed! (" << parsed_nodes.size()
+                  << " classes)\n";
+      }
 
-      std::ofstream header_stream =
-          FileHandler::open_output_stream(header_path);
-      CodeGenerator::generate_header(class_node, header_stream);
-      FileHandler::close_output_stream(header_stream);
+      if (per_class) {
+        std::cout << "---------------- VALIDATION ------------------\n\n";
+      }
+      Validator::ensure_valid_structure(parsed_nodes);
+      if (summary) {
+        std::cout << "All classes valid!\n";
+      }
+      stats.end_phase("validate");
 
-      std::ofstream source_stream =
-          FileHandler::open_output_stream(source_path);
-      CodeGenerator::generate_source(class_node, source_stream);
-      FileHandler::close_output_stream(source_stream);
+      validated_nodes = std::make_shared<const std::vector<ClassNode>>(
+          std::move(parsed_nodes));
+      if (session.ast_cache) {
+        session.ast_cache->insert(input_file.view(),
+                                  session.type_map_identity, validated_nodes);
+      }
+    }
+    const std::vector<ClassNode> &class_nodes = *validated_nodes;
+    stats.count_classes(class_nodes);
+
+    if (per_class) {
+      std::cout << "---------------- CODE GENERATION ------------------\n\n";
+    }
+
+    // Packed layouts must outlive generation, the options point to them
+    ClassLayouts packed_layouts;
+    if (options.generator.pack_fields) {
+      packed_layouts = FieldLayout::compute_class_layouts(class_nodes, true);
+      options.generator.class_layouts = &packed_layouts;
+      if (per_class) {
+        print_layout_report(class_nodes);
+      }
+    }
 
-      std::cout << "Generated files: \n-" << header_path << "\n-" << source_path
+    if (options.reproducible) {
+      std::cout << "Reproducible output digest: "
+                << HashUtils::to_hex(verify_reproducible_output(
+                                 class_nodes, options.generator))
                 << "\n\n";
     }
 
+    // Classes are generated concurrently, results are reported in order
+    ThreadPool pool(options.jobs ? options.jobs
+                                 : ThreadPool::default_worker_count());
+
+    if (!options.bundle_path.empty()) {
+      std::size_t files;
+      if (options.bundle_path == "-" && session.standard_output) {
+        files = write_bundle(class_nodes, options, pool,
+                             *session.standard_output, stats);
+      } else if (options.bundle_path == "-") {
+        DescriptorOutputBuffer stdout_buffer(STDOUT_FILENO);
+        std::ostream standard_output(&stdout_buffer);
+        files = write_bundle(class_nodes, options, pool, standard_output,
+                             stats);
+      } else {
+        files = write_bundle_file(class_nodes, options, pool, stats);
+        if (!options.depfile_path.empty()) {
+          std::ostringstream rule;
+          ManifestFile::write_depfile_rule(
+              rule, {options.bundle_path},
+              ManifestFile::inputs(options.cs_file_path, options));
+          ManifestFile::write_depfile(options.depfile_path, rule.str());
+        }
+      }
+      if (summary) {
+        std::cout << "Bundled " << files << " files into "
+                  << (options.bundle_path == "-" ? "standard output"
+                                                 : options.bundle_path)
+                  << "\n";
+      }
+      stats.end_phase("generate and bundle");
+      report_stats(stats, options);
+      return 0;
+    }
+
+    // Created and opened once, files are written relative to it
+    OutputDirectory output("output", options.durability);
+
+    if (options.unity_units) {
+      UnityFiles files = UnityBuilder::write(
+          UnityBuilder::build(class_nodes, options.unity_units,
+                              options.generator, pool),
+          output);
+      if (options.generator.hash_support) {
+        bool written = GenerationStage::write_hash_check(
+            class_nodes, {UNITY_HEADER_NAME}, output);
+        files.paths.push_back(output.file_path(HASH_CHECK_FILE_NAME));
+        (written ? files.written : files.unchanged)++;
+      }
+      if (per_class) {
+        std::cout << "Generated unity build files: \n";
+        for (const std::string &path : files.paths) {
+          std::cout << "-" << path << "\n";
+        }
+        std::cout << "\n";
+      }
+      if (summary) {
+        std::cout << "Files written: " << files.written
+                  << ", unchanged and skipped: " << files.unchanged << "\n";
+      }
+    } else {
+      std::vector<std::future<GeneratedFiles>> pending =
+          GenerationStage::generate_all(class_nodes, output,
+                                        options.generator, pool);
+      // Every task is done with the output directory, which is destroyed
+      // before the pool, before a failure is rethrown
+      for (std::future<GeneratedFiles> &result : pending) {
+        result.wait();
+      }
+      int written_files = 0, unchanged_files = 0;
+      for (std::future<GeneratedFiles> &result : pending) {
+        GeneratedFiles files = result.get();
+        if (per_class) {
+          std::cout << "Generated files: \n-" << files.header_path
+                    << (files.header_written ? "" : " (unchanged)") << "\n-"
+                    << files.source_path
+                    << (files.source_written ? "" : " (unchanged)")
+                    << "\n\n";
+        }
+        written_files += files.header_written + files.source_written;
+        unchanged_files += !files.header_written + !files.source_written;
+      }
+      if (options.generator.hash_support) {
+        std::vector<std::string> headers;
+        for (const ClassNode &class_node : class_nodes) {
+          headers.push_back(class_node.name + ".hpp");
+        }
+        bool written =
+            GenerationStage::write_hash_check(class_nodes, headers, output);
+        if (per_class) {
+          std::cout << "Generated hash check: \n-"
+                    << output.file_path(HASH_CHECK_FILE_NAME)
+                    << (written ? "" : " (unchanged)") << "\n\n";
+        }
+        (written ? written_files : unchanged_files)++;
+      }
+      if (summary) {
+        std::cout << "Files written: " << written_files
+                  << ", unchanged and skipped: " << unchanged_files << "\n";
+      }
+    }
+    finish_output(output, options);
+    stats.end_phase("generate and write");
+    stats.count_output(output.stats());
+    if (result_cache) {
+      result_cache->store(result_key, input_file.view(), output,
+                          ResultCache::describe(class_nodes));
+      if (summary) {
+        std::cout << "Stored the output in the result cache\n";
+      }
+      stats.end_phase("store in cache");
+      stats.count_cache(result_cache->stats());
+    }
+    report_stats(stats, options);
+
   } catch (const IO_Exception &e) {
     std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
   } catch (const Parser_Exception &e) {
     std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
   } catch (const Validator_Exception &e) {
     std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
   } catch (const Code_Generation_Exception &e) {
     std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
   } catch (const std::exception &e) {
     std::cerr << "Caught unexpected behavior: " << e.what() << '\n';
+    return EXIT_FAILURE;
   }
 
   return 0;
+}
+
+// Warm state of the conversion server: parsed type maps by path and the
+// ASTs of recent inputs. Names converted by NameTransformer stay interned
+// as well, up to NAME_CACHE_CAPACITY per cache.
+struct ServerState {
+  struct LoadedTypeMap {
+    std::filesystem::file_time_type modified;
+    TypeTable table;
+  };
+  std::unordered_map<std::string, LoadedTypeMap> type_maps;
+  std::string installed_type_map; // Identity of TypeTable::active()
+  AstCache ast_cache;
+};
+
+// Installs the type map of a request, loading it only when new or changed
+static void install_type_map(const std::string &type_map_path,
+                             ServerState &state) {
+  if (type_map_path.empty()) {
+    if (!state.installed_type_map.empty()) {
+      TypeTable::install(TypeTable());
+      state.installed_type_map.clear();
+    }
+    return;
+  }
+
+  std::string path = std::filesystem::absolute(type_map_path).string();
+  std::error_code error;
+  auto modified = std::filesystem::last_write_time(path, error);
+  auto loaded = state.type_maps.find(path);
+  if (error || loaded == state.type_maps.end() ||
+      loaded->second.modified != modified) {
+    TypeTable table = TypeTable::load(path);
+    loaded = state.type_maps
+                 .insert_or_assign(path, ServerState::LoadedTypeMap{
+                                             modified, std::move(table)})
+                 .first;
+  }
+
+  std::string identity =
+      path + "@" + std::to_string(modified.time_since_epoch().count());
+  if (identity != state.installed_type_map) {
+    TypeTable::install(loaded->second.table);
+    state.installed_type_map = identity;
+  }
+}
+
+// Runs one request the way the command line would have, in the client's
+// working directory and with its output captured. Requests are handled
+// one at a time, so the process-wide directory and streams can be swapped;
+// both are restored afterwards, so that the server's own relative paths
+// (--trace) keep resolving against the directory it was started in.
+static ConversionResponse handle_request(const ConversionRequest &request,
+                                         ServerState &state) {
+  ConversionResponse response;
+  std::ostringstream output, errors;
+  std::streambuf *saved_output = std::cout.rdbuf(output.rdbuf());
+  std::streambuf *saved_errors = std::cerr.rdbuf(errors.rdbuf());
+  int server_directory = ::open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+  std::vector<char *> argv{const_cast<char *>("main")};
+  for (const std::string &argument : request.arguments) {
+    argv.push_back(const_cast<char *>(argument.c_str()));
+  }
+  argv.push_back(nullptr);
+
+  try {
+    if (server_directory < 0) {
+      throw IO_Exception("Cannot open the server's working directory");
+    }
+    if (::chdir(request.working_directory.c_str()) != 0) {
+      throw IO_Exception(("Cannot enter the working directory '" +
+                          request.working_directory + "'")
+                             .c_str());
+    }
+    ProgramOptions options = OptionsParser::parse(
+        static_cast<int>(argv.size() - 1), argv.data());
+    if (!options.serve_socket_path.empty()) {
+      throw Options_Exception("A conversion server cannot start another");
+    }
+    if (options.watch) {
+      throw Options_Exception("--watch is not available through the server");
+    }
+    if (!options.trace_path.empty()) {
+      throw Options_Exception(
+          "--trace is not available per request, start the server with it");
+    }
+    install_type_map(options.type_map_path, state);
+
+    ConversionSession session;
+    session.standard_input = &request.standard_input;
+    session.standard_output = &output;
+    session.ast_cache = &state.ast_cache;
+    session.type_map_identity = state.installed_type_map;
+    response.exit_status = run_conversion(options, session);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    response.exit_status = EXIT_FAILURE;
+  }
+  if (server_directory >= 0) {
+    if (::fchdir(server_directory) != 0) {
+      std::cerr << "The server could not return to its working directory\n";
+      response.exit_status = EXIT_FAILURE;
+    }
+    ::close(server_directory);
+  }
+
+  std::cout.rdbuf(saved_output);
+  std::cerr.rdbuf(saved_errors);
+  response.standard_output = output.str();
+  response.standard_error = errors.str();
+  return response;
+}
+
+static ConversionServer *running_server = nullptr;
+
+static void stop_running_server(int) { running_server->stop(); }
+
+static int serve_conversions(const std::string &socket_path) {
+  try {
+    ServerState state;
+    ConversionServer server(socket_path,
+                            [&state](const ConversionRequest &request) {
+                              TraceSpan span("request", "directory",
+                                             request.working_directory);
+                              ConversionResponse response =
+                                  handle_request(request, state);
+                              NameTransformer::trim_caches();
+                              return response;
+                            });
+    running_server = &server;
+    std::signal(SIGINT, stop_running_server);
+    std::signal(SIGTERM, stop_running_server);
+
+    std::cout << "Serving conversions on " << server.socket_path()
+              << std::endl;
+    server.serve();
+
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    running_server = nullptr;
+    std::cout << "Served " << server.requests_served() << " requests ("
+              << state.ast_cache.hits() << " cached ASTs reused)\n";
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  // std::cout is only flushed when full or on std::endl, not per line
+  std::ios::sync_with_stdio(false);
+
+  ProgramOptions options;
+  try {
+    options = OptionsParser::parse(argc, argv);
+  } catch (const Options_Exception &e) {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  if (!options.trace_path.empty()) {
+    Trace::name_thread("main");
+    Trace::start();
+  }
+
+  int status;
+  if (!options.serve_socket_path.empty()) {
+    status = serve_conversions(options.serve_socket_path);
+  } else {
+    ConversionSession session;
+    status = run_conversion(options, session);
+  }
+
+  if (!options.trace_path.empty()) {
+    Trace::stop();
+    try {
+      write_trace(options.trace_path);
+    } catch (const IO_Exception &e) {
+      std::cerr << e.what() << '\n';
+      return EXIT_FAILURE;
+    }
+  }
+  return status;
 }
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "name_transformer.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace {
+
+// Byte lookup tables, ASCII letters only (like the "C" locale)
+struct CaseTables {
+  std::array<unsigned char, 256> lower;
+  std::array<unsigned char, 256> upper;
+  std::array<bool, 256> is_upper;
+
+  CaseTables() {
+    for (int c = 0; c < 256; c++) {
+      lower[c] = upper[c] = static_cast<unsigned char>(c);
+      is_upper[c] = c >= 'A' && c <= 'Z';
+      if (c >= 'A' && c <= 'Z')
+        lower[c] = static_cast<unsigned char>(c - 'A' + 'a');
+      if (c >= 'a' && c <= 'z')
+        upper[c] = static_cast<unsigned char>(c - 'a' + 'A');
+    }
+  }
+};
+
+const CaseTables tables;
+
+constexpr std::uint64_t ONES = 0x0101010101010101ULL;
+constexpr std::uint64_t HIGH_BITS = 0x8080808080808080ULL;
+
+// Whether any of the 8 bytes is an ASCII uppercase letter. Bytes >= 0x80
+// never match (SWAR range test, 'A' - 1 < byte < 'Z' + 1).
+bool has_uppercase(std::uint64_t word) {
+  constexpr std::uint64_t low_bits = ONES * 127;
+  std::uint64_t masked = word & low_bits;
+  return ((ONES * (127 + 'Z' + 1) - masked) & ~word &
+          (masked + ONES * (127 - ('A' - 1))) & HIGH_BITS) != 0;
+}
+
+struct NameCache {
+  std::unordered_map<std::string, std::string> names;
+  std::shared_mutex mutex;
+};
+
+NameCache snake_case_cache;
+NameCache pascal_case_cache;
+
+// References stay valid until trim_caches(): unordered_map nodes do not
+// move on rehash
+template <typename Transform>
+const std::string &cached(NameCache &cache, const std::string &name,
+                          Transform transform) {
+  {
+    std::shared_lock<std::shared_mutex> lock(cache.mutex);
+    auto it = cache.names.find(name);
+    if (it != cache.names.end()) {
+      return it->second;
+    }
+  }
+
+  std::string transformed;
+  transformed.reserve(name.size() + name.size() / 2);
+  transform(name, transformed);
+
+  std::unique_lock<std::shared_mutex> lock(cache.mutex);
+  return cache.names.try_emplace(name, std::move(transformed)).first->second;
+}
+
+} // namespace
+
+const std::string &NameTransformer::to_snake_case(const std::string &name) {
+  return cached(snake_case_cache, name, append_snake_case);
+}
+
+const std::string &NameTransformer::to_pascal_case(const std::string &name) {
+  return cached(pascal_case_cache, name, append_pascal_case);
+}
+
+void NameTransformer::append_snake_case(const std::string &name,
+                                        std::string &out) {
+  const unsigned char *data =
+      reinterpret_cast<const unsigned char *>(name.data());
+  std::size_t size = name.size();
+  std::size_t i = 0;
+
+  while (i < size) {
+    // Fast path: copy 8 bytes at once while they hold no uppercase letter
+    if (i + 8 <= size) {
+      std::uint64_t word;
+      std::memcpy(&word, data + i, sizeof(word));
+      if (!has_uppercase(word)) {
+        out.append(name, i, 8);
+        i += 8;
+        continue;
+      }
+    }
+
+    unsigned char c = data[i];
+    if (tables.is_upper[c]) {
+      if (i != 0)
+        out += '_';
+      out += static_cast<char>(tables.lower[c]);
+    } else {
+      out += static_cast<char>(c);
+    }
+    i++;
+  }
+}
+
+void NameTransformer::append_pascal_case(const std::string &name,
+                                         std::string &out) {
+  bool capitalize_next = true;
+  for (unsigned char c : name) {
+    if (c == '_') {
+      capitalize_next = true;
+    } else if (capitalize_next) {
+      out += static_cast<char>(tables.upper[c]);
+      capitalize_next = false;
+    } else {
+      out += static_cast<char>(c);
+    }
+  }
+}
+
+std::size_t NameTransformer::cached_name_count() {
+  std::size_t count = 0;
+  for (NameCache *cache : {&snake_case_cache, &pascal_case_cache}) {
+    std::shared_lock<std::shared_mutex> lock(cache->mutex);
+    count += cache->names.size();
+  }
+  return count;
+}
+
+void NameTransformer::trim_caches() {
+  for (NameCache *cache : {&snake_case_cache, &pascal_case_cache}) {
+    std::unique_lock<std::shared_mutex> lock(cache->mutex);
+    if (cache->names.size() > NAME_CACHE_CAPACITY) {
+      cache->names.clear();
+    }
+  }
+}
@@ -0,0 +1,32 @@
+#ifndef NAME_TRANSFORMER
+#define NAME_TRANSFORMER
+
+#include <cstddef>
+#include <string>
+
+// Names a cache may hold before trim_caches() empties it
+#define NAME_CACHE_CAPACITY 65536
+
+// Identifier case conversion used by the code generator. Conversions are
+// table-driven, and the cached variants memoize every distinct identifier
+// (safe to call from several threads). The returned references stay valid
+// until trim_caches() empties the cache.
+class NameTransformer {
+public:
+  // PascalCase -> snake_case ("IntField" -> "int_field")
+  static const std::string &to_snake_case(const std::string &name);
+  // snake_case -> PascalCase ("int_field" -> "IntField")
+  static const std::string &to_pascal_case(const std::string &name);
+
+  // Uncached conversions appending straight into an output buffer
+  static void append_snake_case(const std::string &name, std::string &out);
+  static void append_pascal_case(const std::string &name, std::string &out);
+
+  static std::size_t cached_name_count();
+  // Empties each cache holding more than NAME_CACHE_CAPACITY names, so that
+  // long-lived processes (--serve, --watch) do not grow without bound. Must
+  // only be called between conversions, while no reference is in use.
+  static void trim_caches();
+};
+
+#endif
@@ -0,0 +1,255 @@
+#include "options.hpp"
+#include "conversion_server.hpp"
+#include "custom_exceptions.hpp"
+#include "result_cache.hpp"
+#include <filesystem>
+#include <limits>
+
+ProgramOptions OptionsParser::parse(int argc, char *argv[]) {
+  ProgramOptions options;
+  options.cache_directory = ResultCache::default_directory();
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg{argv[i]};
+
+    if (arg == "--reproducible") {
+      options.reproducible = true;
+    } else if (arg == "--stats") {
+      options.stats = StatsFormat::Text;
+    } else if (arg == "--stats-file" || arg.rfind("--stats-file=", 0) == 0) {
+      options.stats_path = option_value(argc, argv, i, arg);
+    } else if (arg.rfind("--stats=", 0) == 0) {
+      options.stats = parse_stats_format(option_value(argc, argv, i, arg));
+    } else if (arg == "--trace" || arg.rfind("--trace=", 0) == 0) {
+      options.trace_path = option_value(argc, argv, i, arg);
+    } else if (arg == "--depfile" || arg == "-MF" ||
+               arg.rfind("--depfile=", 0) == 0) {
+      options.depfile_path = option_value(argc, argv, i, arg);
+    } else if (arg == "--cache" || arg.rfind("--cache=", 0) == 0) {
+      options.cache_directory = option_value(argc, argv, i, arg);
+    } else if (arg == "--no-cache") {
+      options.cache_directory.clear();
+    } else if (arg == "--cache-limit" || arg.rfind("--cache-limit=", 0) == 0) {
+      options.cache_limit_mib =
+          parse_count("--cache-limit", option_value(argc, argv, i, arg));
+    } else if (arg == "-q" || arg == "--quiet") {
+      options.verbosity = Verbosity::Quiet;
+    } else if (arg == "--verbosity" || arg.rfind("--verbosity=", 0) == 0) {
+      options.verbosity = parse_verbosity(option_value(argc, argv, i, arg));
+    } else if (arg == "--pack-fields") {
+      options.generator.pack_fields = true;
+    } else if (arg == "--hash-support") {
+      options.generator.hash_support = true;
+    } else if (arg == "-j" || arg == "--jobs" ||
+               arg.rfind("--jobs=", 0) == 0) {
+      options.jobs = parse_count("--jobs", option_value(argc, argv, i, arg));
+    } else if (arg == "--unity" || arg.rfind("--unity=", 0) == 0) {
+      options.unity_units =
+          parse_count("--unity", option_value(argc, argv, i, arg));
+    } else if (arg == "--durability" ||
+               arg.rfind("--durability=", 0) == 0) {
+      options.durability = parse_durability(option_value(argc, argv, i, arg));
+    } else if (arg == "--bundle" || arg.rfind("--bundle=", 0) == 0) {
+      options.bundle_path = option_value(argc, argv, i, arg);
+    } else if (arg == "--watch") {
+      options.watch = true;
+    } else if (arg == "--debounce" || arg.rfind("--debounce=", 0) == 0) {
+      options.debounce_milliseconds =
+          parse_count("--debounce", option_value(argc, argv, i, arg));
+    } else if (arg == "--serve") {
+      options.serve_socket_path = ConversionServer::default_socket_path();
+    } else if (arg.rfind("--serve=", 0) == 0) {
+      options.serve_socket_path = option_value(argc, argv, i, arg);
+    } else if (arg == "--type-map" || arg.rfind("--type-map=", 0) == 0) {
+      options.type_map_path = option_value(argc, argv, i, arg);
+    } else if (arg == "--emission-policy" ||
+               arg.rfind("--emission-policy=", 0) == 0) {
+      options.generator.signature_policy =
+          parse_signature_policy(option_value(argc, argv, i, arg));
+    } else if (arg.rfind("--", 0) == 0) {
+      throw Options_Exception(("Unknown option '" + arg + "'").c_str());
+    } else {
+      options.input_paths.push_back(arg);
+    }
+  }
+
+  // Inputs come with each request, the other options are ignored
+  if (!options.serve_socket_path.empty()) {
+    if (!options.input_paths.empty()) {
+      throw Options_Exception("--serve takes no input files");
+    }
+    return options;
+  }
+
+  if (options.input_paths.empty()) {
+    throw Options_Exception(usage().c_str());
+  }
+  if (!options.stats_path.empty() && options.stats == StatsFormat::None) {
+    options.stats = StatsFormat::Text;
+  }
+  options.cs_file_path = options.input_paths.front();
+
+  if (options.watch &&
+      (options.cs_file_path == "-" || !options.bundle_path.empty() ||
+       options.reproducible)) {
+    throw Options_Exception(
+        "--watch converts files into output/, not standard input, bundles "
+        "or --reproducible runs");
+  }
+  if (!options.depfile_path.empty() &&
+      (options.watch || options.cs_file_path == "-" ||
+       options.bundle_path == "-")) {
+    throw Options_Exception(
+        "--depfile needs input and output files, not standard input or "
+        "output, and is not written by --watch");
+  }
+
+  // Batch mode: several files, or directory trees searched for .cs files
+  options.batch = options.input_paths.size() > 1 ||
+                  std::filesystem::is_directory(options.cs_file_path);
+  if (options.batch) {
+    for (const std::string &path : options.input_paths) {
+      if (path == "-") {
+        throw Options_Exception(
+            "Standard input cannot be combined with other inputs");
+      }
+      if (!is_cs_file_path(path) && !std::filesystem::is_directory(path)) {
+        throw Options_Exception(("Input '" + path +
+                                 "' is neither a .cs file nor a directory")
+                                    .c_str());
+      }
+    }
+    if (!options.bundle_path.empty() || options.reproducible) {
+      throw Options_Exception(
+          "--bundle and --reproducible take a single .cs file");
+    }
+    return options;
+  }
+
+  // Streaming mode: C# on standard input, a bundle on standard output
+  if (options.cs_file_path == "-") {
+    if (options.bundle_path.empty()) {
+      options.bundle_path = "-";
+    }
+    return options;
+  }
+
+  if (!is_cs_file_path(options.cs_file_path)) {
+    throw Options_Exception("Must provide a .cs file path. This program only "
+                            "works for C# files.");
+  }
+
+  return options;
+}
+
+std::string OptionsParser::usage() {
+  return "To run the program you need to provide the .cs file path through "
+         "the command line. Ex.: \"./main [--reproducible] "
+         "[--stats[=text|json] [--stats-file FILE]] [--trace FILE] "
+         "[--depfile FILE] [--cache DIR [--cache-limit MB]|--no-cache] "
+         "[-q|--verbosity quiet|summary|classes|ast] "
+         "[--jobs N] [--unity N] [--emission-policy literal|performance] "
+         "[--pack-fields] [--hash-support] [--type-map FILE] "
+         "[--durability none|batched|per-file] [--bundle FILE|-] "
+         "[--watch [--debounce MS]] "
+         "example.cs|-\" or, in batch mode, \"./main [options] "
+         "FILE.cs|DIRECTORY...\", or \"./main --serve[=SOCKET] "
+         "[--trace FILE]\" to start a conversion server for "
+         "converter_client";
+}
+
+bool OptionsParser::is_cs_file_path(const std::string &path) {
+  return path.length() > 3 && path.substr(path.length() - 3, 3) == ".cs";
+}
+
+// Value of an option given either as "--option=value" or "--option value"
+std::string OptionsParser::option_value(int argc, char *argv[], int &i,
+                                        const std::string &option) {
+  std::size_t equals = option.find('=');
+  if (equals != std::string::npos) {
+    return option.substr(equals + 1);
+  }
+  if (i + 1 >= argc) {
+    throw Options_Exception(
+        ("Missing value for option '" + option + "'").c_str());
+  }
+  return argv[++i];
+}
+
+SignaturePolicy
+OptionsParser::parse_signature_policy(const std::string &value) {
+  if (value == "literal") {
+    return SignaturePolicy::Literal;
+  }
+  if (value == "performance") {
+    return SignaturePolicy::Performance;
+  }
+  throw Options_Exception(("Unknown emission policy '" + value +
+                           "', expected 'literal' or 'performance'")
+                              .c_str());
+}
+
+Durability OptionsParser::parse_durability(const std::string &value) {
+  if (value == "none") {
+    return Durability::None;
+  }
+  if (value == "batched") {
+    return Durability::Batched;
+  }
+  if (value == "per-file") {
+    return Durability::PerFile;
+  }
+  throw Options_Exception(("Unknown durability '" + value +
+                           "', expected 'none', 'batched' or 'per-file'")
+                              .c_str());
+}
+
+Verbosity OptionsParser::parse_verbosity(const std::string &value) {
+  if (value == "quiet") {
+    return Verbosity::Quiet;
+  }
+  if (value == "summary") {
+    return Verbosity::Summary;
+  }
+  if (value == "classes") {
+    return Verbosity::Classes;
+  }
+  if (value == "ast") {
+    return Verbosity::Ast;
+  }
+  throw Options_Exception(("Unknown verbosity '" + value +
+                           "', expected 'quiet', 'summary', 'classes' or "
+                           "'ast'")
+                              .c_str());
+}
+
+StatsFormat OptionsParser::parse_stats_format(const std::string &value) {
+  if (value == "text") {
+    return StatsFormat::Text;
+  }
+  if (value == "json") {
+    return StatsFormat::Json;
+  }
+  throw Options_Exception(("Unknown stats format '" + value +
+                           "', expected 'text' or 'json'")
+                              .c_str());
+}
+
+std::size_t OptionsParser::parse_count(const std::string &option,
+                                       const std::string &value) {
+  std::size_t parsed_chars = 0;
+  unsigned long count = 0;
+  try {
+    count = std::stoul(value, &parsed_chars);
+  } catch (const std::exception &) {
+    parsed_chars = 0;
+  }
+  if (parsed_chars == 0 || parsed_chars != value.size() || count == 0 ||
+      count > std::numeric_limits<unsigned int>::max()) {
+    throw Options_Exception(
+        ("Option '" + option + "' expects a positive number, got '" + value +
+         "'")
+            .c_str());
+  }
+  return count;
+}
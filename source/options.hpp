@@ -0,0 +1,64 @@
+#ifndef OPTIONS
+#define OPTIONS
+
+#include "code_generator.hpp"
+#include "output_directory.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How much the converter prints. Errors and explicitly requested reports
+// (--stats, --reproducible) are printed at every level.
+enum class Verbosity {
+  Quiet,   // Errors only
+  Summary, // One line per phase with counts
+  Classes, // Phase banners and every generated file (default)
+  Ast      // Also a dump of the parsed classes before validation
+};
+
+// Format of the --stats report
+enum class StatsFormat { None, Text, Json };
+
+// Settings selected through the command line
+struct ProgramOptions {
+  std::string cs_file_path; // "-" reads standard input
+  std::vector<std::string> input_paths; // Every .cs file or directory given
+  bool batch = false; // Several inputs or a directory, see BatchConverter
+  bool reproducible = false; // Render twice and report an output digest
+  StatsFormat stats = StatsFormat::None; // Per-phase time and throughput
+  std::string stats_path; // Stats report file, standard output if empty
+  std::string trace_path; // Chrome trace-event JSON of the run, optional
+  std::string depfile_path; // Make rules from outputs to inputs, optional
+  std::string cache_directory; // Result cache, see ResultCache; off if empty
+  std::uint64_t cache_limit_mib = 1024; // Cache evicted down to this size
+  std::size_t jobs = 0;      // Generation workers, 0 means one per core
+  std::size_t unity_units = 0; // Unity translation units, 0 means disabled
+  std::string type_map_path;    // Extra C# -> C++ type mappings, optional
+  Durability durability = Durability::None; // fsync policy of output files
+  std::string bundle_path; // Single bundle instead of output/, "-" is stdout
+  std::string serve_socket_path; // Run as a conversion server, see --serve
+  bool watch = false; // Convert again whenever an input changes
+  std::size_t debounce_milliseconds = 5; // Quiet time ending a burst of saves
+  Verbosity verbosity = Verbosity::Classes;
+  GeneratorOptions generator;
+};
+
+class OptionsParser {
+public:
+  static ProgramOptions parse(int argc, char *argv[]);
+  static std::string usage();
+
+private:
+  static bool is_cs_file_path(const std::string &path);
+  static std::string option_value(int argc, char *argv[], int &i,
+                                  const std::string &option);
+  static SignaturePolicy parse_signature_policy(const std::string &value);
+  static Durability parse_durability(const std::string &value);
+  static Verbosity parse_verbosity(const std::string &value);
+  static StatsFormat parse_stats_format(const std::string &value);
+  static std::size_t parse_count(const std::string &option,
+                                 const std::string &value);
+};
+
+#endif
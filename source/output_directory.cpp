@@ -0,0 +1,479 @@
+#include "output_directory.hpp"
+#include "custom_exceptions.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <csignal>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// A temporary file of a process that is still running is only considered
+// abandoned after this long, its pid may have been reused
+#define ABANDONED_TEMPORARY_AGE std::chrono::hours(1)
+
+static std::uint64_t nanoseconds_since(
+    std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+static IO_Exception output_error(const std::string &path,
+                                 const std::string &action) {
+  return IO_Exception(("Failed to " + action + " '" + path +
+                       "': " + std::strerror(errno))
+                          .c_str());
+}
+
+OutputDirectory::OutputDirectory(const std::string &directory_name,
+                                 Durability durability)
+    : directory_name(directory_name), durability(durability) {
+  auto start = std::chrono::steady_clock::now();
+  try {
+    fs::create_directories(directory_name);
+  } catch (const fs::filesystem_error &e) {
+    throw IO_Exception(("Filesystem error: " + std::string(e.what())).c_str());
+  }
+
+  directory_fd =
+      ::open(directory_name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (directory_fd < 0) {
+    throw output_error(directory_name, "open the output directory");
+  }
+  remove_abandoned_temporaries();
+  resolve_nanoseconds = nanoseconds_since(start);
+}
+
+OutputDirectory::~OutputDirectory() {
+  if (directory_fd >= 0) {
+    for (const PendingRename &rename : pending_renames) {
+      ::unlinkat(directory_fd, rename.temporary_name.c_str(), 0);
+    }
+    ::close(directory_fd);
+  }
+}
+
+const std::string &OutputDirectory::name() const { return directory_name; }
+
+std::string OutputDirectory::file_path(const std::string &file_name) const {
+  if (!directory_name.empty() && directory_name.back() == '/') {
+    return directory_name + file_name;
+  }
+  return directory_name + "/" + file_name;
+}
+
+bool OutputDirectory::write_if_changed(const std::string &file_name,
+                                       std::string_view content) {
+  TraceSpan span("write", "file", file_name);
+  auto start = std::chrono::steady_clock::now();
+  bool written = !has_same_content(file_name, content);
+  if (written) {
+    write_file(file_name, content);
+    bytes_written += content.size();
+  }
+  (written ? files_written : files_unchanged)++;
+  keep(file_name);
+  write_nanoseconds += nanoseconds_since(start);
+  return written;
+}
+
+void OutputDirectory::write(const std::string &file_name,
+                            std::string_view content) {
+  TraceSpan span("write", "file", file_name);
+  auto start = std::chrono::steady_clock::now();
+  write_file(file_name, content);
+  keep(file_name);
+  write_nanoseconds += nanoseconds_since(start);
+}
+
+void OutputDirectory::commit() {
+  TraceSpan span("commit", "file", directory_name);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<PendingRename> renames;
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    renames.swap(pending_renames);
+  }
+
+  // One flush of the whole file system instead of one fsync per file. The
+  // data has to be on disk before the renames, or a power loss could leave
+  // empty files under the final names.
+  if (!renames.empty() && ::syncfs(directory_fd) != 0) {
+    for (const PendingRename &rename : renames) {
+      int fd = ::openat(directory_fd, rename.temporary_name.c_str(),
+                        O_RDONLY | O_CLOEXEC);
+      if (fd < 0 || ::fsync(fd) != 0) {
+        IO_Exception error =
+            output_error(file_path(rename.file_name), "sync");
+        if (fd >= 0)
+          ::close(fd);
+        pending_renames = renames; // Removed by the destructor
+        throw error;
+      }
+      ::close(fd);
+    }
+  }
+  for (std::size_t i = 0; i < renames.size(); i++) {
+    try {
+      rename_into_place(renames[i]);
+    } catch (const IO_Exception &) {
+      pending_renames.assign(renames.begin() + i + 1, renames.end());
+      throw;
+    }
+  }
+
+  // Makes the renames themselves durable
+  if (durability != Durability::None && files_written > 0 &&
+      ::fsync(directory_fd) != 0) {
+    throw output_error(directory_name, "sync the output directory");
+  }
+  commit_nanoseconds += nanoseconds_since(start);
+}
+
+void OutputDirectory::commit(DeferredCommit &deferred) {
+  if (durability != Durability::Batched) {
+    commit();
+    return;
+  }
+  TraceSpan span("defer commit", "file", directory_name);
+  std::lock_guard<std::mutex> lock(pending_mutex);
+  std::lock_guard<std::mutex> deferred_lock(deferred.renames_mutex);
+  for (PendingRename &rename : pending_renames) {
+    deferred.renames.push_back(DeferredCommit::Rename{
+        file_path(rename.temporary_name), file_path(rename.file_name)});
+    deferred_renames.push_back(std::move(rename));
+  }
+  pending_renames.clear();
+}
+
+std::string OutputDirectory::content_path(const std::string &file_name) const {
+  std::lock_guard<std::mutex> lock(pending_mutex);
+  for (const std::vector<PendingRename> *renames :
+       {&pending_renames, &deferred_renames}) {
+    // The last write of a file is the one renamed last
+    for (auto it = renames->rbegin(); it != renames->rend(); ++it) {
+      if (it->file_name == file_name) {
+        return file_path(it->temporary_name);
+      }
+    }
+  }
+  return file_path(file_name);
+}
+
+DeferredCommit::~DeferredCommit() {
+  for (const Rename &rename : renames) {
+    ::unlink(rename.temporary_path.c_str());
+  }
+}
+
+void DeferredCommit::commit() {
+  TraceSpan span("commit deferred renames");
+  std::vector<Rename> pending;
+  {
+    std::lock_guard<std::mutex> lock(renames_mutex);
+    pending.swap(renames);
+  }
+  // Renames not done are handed back, for the destructor to remove
+  auto keep_from = [&](std::size_t first) {
+    std::lock_guard<std::mutex> lock(renames_mutex);
+    renames.insert(renames.end(), pending.begin() + first, pending.end());
+  };
+
+  // One open directory per file system the renames are on, usually one
+  struct FileSystems {
+    std::vector<dev_t> devices;
+    std::vector<int> fds;
+    ~FileSystems() {
+      for (int fd : fds)
+        ::close(fd);
+    }
+  } file_systems;
+  std::string previous_directory;
+  for (const Rename &rename : pending) {
+    std::string directory =
+        fs::path(rename.final_path).parent_path().string();
+    if (directory.empty()) {
+      directory = ".";
+    }
+    if (directory == previous_directory) {
+      continue;
+    }
+    previous_directory = directory;
+    struct stat status;
+    if (::stat(directory.c_str(), &status) != 0) {
+      IO_Exception error = output_error(directory, "open the output directory");
+      keep_from(0);
+      throw error;
+    }
+    if (std::find(file_systems.devices.begin(), file_systems.devices.end(),
+                  status.st_dev) != file_systems.devices.end()) {
+      continue;
+    }
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+      IO_Exception error = output_error(directory, "open the output directory");
+      keep_from(0);
+      throw error;
+    }
+    file_systems.devices.push_back(status.st_dev);
+    file_systems.fds.push_back(fd);
+  }
+  auto sync_file_systems = [&]() {
+    for (int fd : file_systems.fds) {
+      if (::syncfs(fd) != 0) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  // The data has to be on disk before the renames, as in commit()
+  if (!sync_file_systems()) {
+    for (const Rename &rename : pending) {
+      int fd = ::open(rename.temporary_path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0 || ::fsync(fd) != 0) {
+        IO_Exception error = output_error(rename.final_path, "sync");
+        if (fd >= 0)
+          ::close(fd);
+        keep_from(0);
+        throw error;
+      }
+      ::close(fd);
+    }
+  }
+  for (std::size_t i = 0; i < pending.size(); i++) {
+    if (::rename(pending[i].temporary_path.c_str(),
+                 pending[i].final_path.c_str()) != 0) {
+      IO_Exception error = output_error(pending[i].final_path, "rename");
+      keep_from(i);
+      throw error;
+    }
+  }
+
+  // Makes the renames in every directory durable at once
+  if (!sync_file_systems()) {
+    throw output_error(previous_directory, "sync the file system of");
+  }
+}
+
+bool OutputDirectory::remove(const std::string &file_name) {
+  if (::unlinkat(directory_fd, file_name.c_str(), 0) == 0) {
+    return true;
+  }
+  if (errno == ENOENT) {
+    return false;
+  }
+  throw output_error(file_path(file_name), "remove");
+}
+
+bool OutputDirectory::link_if_changed(const std::string &file_name,
+                                      const std::string &source_path,
+                                      std::string_view content) {
+  TraceSpan span("link", "file", file_name);
+  auto start = std::chrono::steady_clock::now();
+  bool written = !has_same_content(file_name, content);
+  if (written) {
+    PendingRename rename{temporary_name(file_name), file_name};
+    if (::linkat(AT_FDCWD, source_path.c_str(), directory_fd,
+                 rename.temporary_name.c_str(), 0) == 0) {
+      // The entry is synced when the link is: fsync goes to the inode
+      int fd = durability == Durability::PerFile
+                   ? ::openat(directory_fd, rename.temporary_name.c_str(),
+                              O_RDONLY | O_CLOEXEC)
+                   : -1;
+      if (durability == Durability::PerFile &&
+          (fd < 0 || ::fsync(fd) != 0)) {
+        IO_Exception error = output_error(file_path(file_name), "sync");
+        if (fd >= 0)
+          ::close(fd);
+        ::unlinkat(directory_fd, rename.temporary_name.c_str(), 0);
+        throw error;
+      }
+      if (fd >= 0)
+        ::close(fd);
+      place_file(std::move(rename));
+    } else if (errno == EXDEV || errno == EPERM || errno == EMLINK) {
+      write_file(file_name, content);
+    } else {
+      throw output_error(file_path(file_name), "link");
+    }
+    bytes_written += content.size();
+  }
+  (written ? files_written : files_unchanged)++;
+  keep(file_name);
+  write_nanoseconds += nanoseconds_since(start);
+  return written;
+}
+
+void OutputDirectory::keep(const std::string &file_name) {
+  std::lock_guard<std::mutex> lock(file_names_mutex);
+  produced_files.push_back(file_name);
+}
+
+std::vector<std::string> OutputDirectory::file_names() const {
+  std::vector<std::string> names;
+  {
+    std::lock_guard<std::mutex> lock(file_names_mutex);
+    names = produced_files;
+  }
+  std::sort(names.begin(), names.end());
+  names.erase(std::unique(names.begin(), names.end()), names.end());
+  return names;
+}
+
+OutputDirectoryStats OutputDirectory::stats() const {
+  return OutputDirectoryStats{resolve_nanoseconds, write_nanoseconds.load(),
+                              commit_nanoseconds, files_written.load(),
+                              files_unchanged.load(), bytes_written.load()};
+}
+
+// One openat + fstat instead of a path lookup; only reads the file back when
+// the sizes match
+bool OutputDirectory::has_same_content(const std::string &file_name,
+                                       std::string_view content) const {
+  int fd = ::openat(directory_fd, file_name.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  bool same = false;
+  struct stat status;
+  if (::fstat(fd, &status) == 0 &&
+      static_cast<std::uintmax_t>(status.st_size) == content.size()) {
+    std::string existing(content.size(), '\0');
+    std::size_t used = 0;
+    while (used < existing.size()) {
+      ssize_t count = ::read(fd, existing.data() + used, existing.size() - used);
+      if (count < 0 && errno == EINTR)
+        continue;
+      if (count <= 0)
+        break;
+      used += static_cast<std::size_t>(count);
+    }
+    same = used == existing.size() && existing == content;
+  }
+  ::close(fd);
+  return same;
+}
+
+// Written under a temporary name first, so the final name only ever refers
+// to a complete file
+void OutputDirectory::write_file(const std::string &file_name,
+                                 std::string_view content) {
+  PendingRename rename{temporary_name(file_name), file_name};
+  int fd = ::openat(directory_fd, rename.temporary_name.c_str(),
+                    O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+  if (fd < 0) {
+    throw output_error(file_path(file_name), "create a temporary file for");
+  }
+  auto fail = [&](const std::string &action) {
+    IO_Exception error = output_error(file_path(file_name), action);
+    ::close(fd);
+    ::unlinkat(directory_fd, rename.temporary_name.c_str(), 0);
+    return error;
+  };
+
+  std::size_t used = 0;
+  while (used < content.size()) {
+    ssize_t count = ::write(fd, content.data() + used, content.size() - used);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count < 0) {
+      throw fail("write");
+    }
+    used += static_cast<std::size_t>(count);
+  }
+  if (durability == Durability::PerFile && ::fsync(fd) != 0) {
+    throw fail("sync");
+  }
+  if (::close(fd) != 0) {
+    ::unlinkat(directory_fd, rename.temporary_name.c_str(), 0);
+    throw output_error(file_path(file_name), "close");
+  }
+  place_file(std::move(rename));
+}
+
+// Renamed now, or at commit() with batched durability
+void OutputDirectory::place_file(PendingRename rename) {
+  if (durability == Durability::Batched) {
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    pending_renames.push_back(std::move(rename));
+    return;
+  }
+  rename_into_place(rename);
+}
+
+// Hidden and without the .hpp/.cpp extension, so leftovers of a killed run
+// are never picked up as sources; unique across threads and processes
+std::string OutputDirectory::temporary_name(const std::string &file_name) {
+  return "." + file_name + "." + std::to_string(::getpid()) + "." +
+         std::to_string(temporary_count++) + ".tmp";
+}
+
+// Temporary files of a killed run would otherwise stay forever: they are
+// not in any manifest. Those of this process may still be waiting for a
+// deferred commit and are left alone.
+void OutputDirectory::remove_abandoned_temporaries() {
+  int fd = ::openat(directory_fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  DIR *directory = fd >= 0 ? ::fdopendir(fd) : nullptr;
+  if (!directory) {
+    if (fd >= 0)
+      ::close(fd);
+    return; // Only costs the leftovers
+  }
+  auto abandoned = std::chrono::system_clock::now() - ABANDONED_TEMPORARY_AGE;
+  std::string own_pid = std::to_string(::getpid());
+  while (dirent *entry = ::readdir(directory)) {
+    // .<file name>.<pid>.<count>.tmp
+    std::string name = entry->d_name;
+    const std::string suffix = ".tmp";
+    if (name.size() <= suffix.size() || name[0] != '.' ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) !=
+            0) {
+      continue;
+    }
+    std::string stem = name.substr(0, name.size() - suffix.size());
+    std::size_t count_dot = stem.rfind('.');
+    std::size_t pid_dot =
+        count_dot == 0 || count_dot == std::string::npos
+            ? std::string::npos
+            : stem.rfind('.', count_dot - 1);
+    if (pid_dot == std::string::npos || pid_dot == 0) {
+      continue;
+    }
+    std::string pid = stem.substr(pid_dot + 1, count_dot - pid_dot - 1);
+    if (pid.empty() || pid.size() > 9 || pid == own_pid ||
+        pid.find_first_not_of("0123456789") != std::string::npos) {
+      continue;
+    }
+
+    bool dead = ::kill(static_cast<pid_t>(std::stol(pid)), 0) != 0 &&
+                errno == ESRCH;
+    struct stat status;
+    bool old = ::fstatat(directory_fd, name.c_str(), &status,
+                         AT_SYMLINK_NOFOLLOW) == 0 &&
+               std::chrono::system_clock::from_time_t(status.st_mtime) <
+                   abandoned;
+    if (dead || old) {
+      ::unlinkat(directory_fd, name.c_str(), 0);
+    }
+  }
+  ::closedir(directory);
+}
+
+void OutputDirectory::rename_into_place(const PendingRename &rename) {
+  if (::renameat(directory_fd, rename.temporary_name.c_str(), directory_fd,
+                 rename.file_name.c_str()) != 0) {
+    IO_Exception error = output_error(file_path(rename.file_name), "rename");
+    ::unlinkat(directory_fd, rename.temporary_name.c_str(), 0);
+    throw error;
+  }
+}
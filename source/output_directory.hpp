@@ -0,0 +1,154 @@
+#ifndef OUTPUT_DIRECTORY_HPP
+#define OUTPUT_DIRECTORY_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// How far a written file is guaranteed to survive. Files are always written
+// to a temporary name and renamed into place, so a crashed or killed run
+// never leaves a truncated file behind; the levels add power-loss safety.
+enum class Durability {
+  None,    // No fsync, renamed as soon as written
+  Batched, // Renames deferred to commit(), one syncfs before them and one
+           // directory fsync after them for the whole run
+  PerFile  // fsync of every file before its rename, directory fsync on commit
+};
+
+// Time spent on the output directory, for the --stats report
+struct OutputDirectoryStats {
+  std::uint64_t resolve_nanoseconds = 0; // Creating and opening it, once
+  std::uint64_t write_nanoseconds = 0;   // Comparing and writing files,
+                                         // summed over all threads
+  std::uint64_t commit_nanoseconds = 0;  // Syncing and renaming in commit()
+  std::size_t files_written = 0;
+  std::size_t files_unchanged = 0;
+  std::uint64_t bytes_written = 0;
+};
+
+// Renames of several output directories made durable together, e.g. all
+// directories of a batch run: with Durability::Batched, directories
+// committed into it leave their files under temporary names until
+// commit(), which syncs the file system once before all the renames and
+// once after them. Directories can be committed from several threads.
+class DeferredCommit {
+public:
+  DeferredCommit() = default;
+  // Temporary files never committed are removed
+  ~DeferredCommit();
+
+  DeferredCommit(const DeferredCommit &) = delete;
+  DeferredCommit &operator=(const DeferredCommit &) = delete;
+
+  // Throws IO_Exception when a file cannot be synced or renamed
+  void commit();
+
+private:
+  friend class OutputDirectory;
+
+  struct Rename {
+    std::string temporary_path;
+    std::string final_path;
+  };
+
+  std::mutex renames_mutex;
+  std::vector<Rename> renames;
+};
+
+// Output directory created and opened once. Files are then compared and
+// written relative to the open directory handle (openat), without checking
+// for the directory or resolving its path again for every file. Files can be
+// written from several threads at once.
+class OutputDirectory {
+public:
+  // Temporary files left behind by killed runs are removed when opening
+  explicit OutputDirectory(const std::string &directory_name,
+                           Durability durability = Durability::None);
+  // Temporary files never committed are removed
+  ~OutputDirectory();
+
+  OutputDirectory(const OutputDirectory &) = delete;
+  OutputDirectory &operator=(const OutputDirectory &) = delete;
+
+  const std::string &name() const;
+  // Path of a file in the directory, for reporting
+  std::string file_path(const std::string &file_name) const;
+
+  // Leaves the file untouched (keeping its mtime) when it already holds
+  // exactly this content. Returns whether the file was written.
+  bool write_if_changed(const std::string &file_name,
+                        std::string_view content);
+  // Always writes, for files whose mtime tells a build system that the run
+  // happened (the manifest). Not counted in stats(), which are about the
+  // generated code.
+  void write(const std::string &file_name, std::string_view content);
+
+  // Same as write_if_changed, but a changed file is hard-linked from
+  // source_path, which must hold exactly content (a result cache entry).
+  // Copied from content when the link is impossible, e.g. across file
+  // systems.
+  bool link_if_changed(const std::string &file_name,
+                       const std::string &source_path,
+                       std::string_view content);
+
+  // Deletes a file that is no longer generated. Returns false when there
+  // was none; throws IO_Exception when it cannot be removed.
+  bool remove(const std::string &file_name);
+
+  // Counts a file left in place without comparing it, e.g. a class that an
+  // incremental run knows to be unchanged, as output of this run
+  void keep(const std::string &file_name);
+  // Files written, found unchanged or kept so far, sorted; what the
+  // manifest lists
+  std::vector<std::string> file_names() const;
+
+  // Makes every file written so far durable as the durability level asks.
+  // Must be called once all writes are done; with Durability::Batched files
+  // only appear under their final names here.
+  void commit();
+  // Same as commit(), but with Durability::Batched the renames are left to
+  // deferred.commit()
+  void commit(DeferredCommit &deferred);
+
+  // Path holding the content this run gave a file: the temporary file as
+  // long as its rename is pending or deferred, its final path otherwise
+  std::string content_path(const std::string &file_name) const;
+
+  OutputDirectoryStats stats() const;
+
+private:
+  struct PendingRename {
+    std::string temporary_name;
+    std::string file_name;
+  };
+
+  std::string directory_name;
+  Durability durability;
+  int directory_fd = -1;
+  std::uint64_t resolve_nanoseconds = 0;
+  std::uint64_t commit_nanoseconds = 0;
+  std::atomic<std::uint64_t> write_nanoseconds{0};
+  std::atomic<std::size_t> files_written{0};
+  std::atomic<std::size_t> files_unchanged{0};
+  std::atomic<std::uint64_t> bytes_written{0};
+  std::atomic<std::size_t> temporary_count{0};
+  mutable std::mutex pending_mutex;
+  std::vector<PendingRename> pending_renames;
+  std::vector<PendingRename> deferred_renames; // Owned by a DeferredCommit
+  mutable std::mutex file_names_mutex;
+  std::vector<std::string> produced_files;
+
+  bool has_same_content(const std::string &file_name,
+                        std::string_view content) const;
+  void write_file(const std::string &file_name, std::string_view content);
+  std::string temporary_name(const std::string &file_name);
+  void remove_abandoned_temporaries();
+  void place_file(PendingRename rename);
+  void rename_into_place(const PendingRename &rename);
+};
+
+#endif
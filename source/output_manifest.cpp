@@ -0,0 +1,157 @@
+#include "output_manifest.hpp"
+#include "custom_exceptions.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#define MANIFEST_VERSION_LINE "cs-converter-manifest 1"
+
+ManifestUpdate ManifestFile::update(OutputDirectory &directory,
+                                    const std::vector<std::string> &inputs) {
+  ManifestUpdate update;
+  update.manifest.inputs = inputs;
+  for (const std::string &file_name : directory.file_names()) {
+    if (file_name != MANIFEST_FILE_NAME) {
+      update.manifest.outputs.push_back(file_name);
+    }
+  }
+
+  // Outputs of another input converted into the same directory are not
+  // stale, only those this input generated last time
+  OutputManifest previous = read(directory);
+  if (!same_input(previous, update.manifest)) {
+    previous.outputs.clear();
+  }
+  for (const std::string &file_name : previous.outputs) {
+    // Only plain names, a damaged manifest must not reach outside
+    if (file_name.find('/') != std::string::npos ||
+        file_name == MANIFEST_FILE_NAME || file_name == "." ||
+        file_name == ".." ||
+        std::binary_search(update.manifest.outputs.begin(),
+                           update.manifest.outputs.end(), file_name)) {
+      continue;
+    }
+    if (directory.remove(file_name)) {
+      update.stale_files.push_back(file_name);
+    }
+  }
+
+  // Rewritten even when unchanged: its mtime is what Make compares to the
+  // inputs, while the outputs keep theirs when their content is the same
+  directory.write(MANIFEST_FILE_NAME, format(update.manifest));
+  return update;
+}
+
+// The .cs file decides, so that adding a type map still removes stale files
+bool ManifestFile::same_input(const OutputManifest &previous,
+                              const OutputManifest &current) {
+  if (previous.inputs.empty() || current.inputs.empty()) {
+    return false;
+  }
+  return std::filesystem::path(previous.inputs.front()).lexically_normal() ==
+         std::filesystem::path(current.inputs.front()).lexically_normal();
+}
+
+OutputManifest ManifestFile::read(const OutputDirectory &directory) {
+  std::ifstream input(directory.file_path(MANIFEST_FILE_NAME));
+  if (input.fail()) {
+    return OutputManifest();
+  }
+  return parse(input);
+}
+
+OutputManifest ManifestFile::parse(std::istream &input) {
+  OutputManifest manifest;
+  std::string line;
+  if (!std::getline(input, line) || line != MANIFEST_VERSION_LINE) {
+    return manifest;
+  }
+  while (std::getline(input, line)) {
+    std::size_t space = line.find(' ');
+    std::string key = line.substr(0, space);
+    std::string value =
+        space == std::string::npos ? std::string() : line.substr(space + 1);
+    if (value.empty()) {
+      continue;
+    }
+    if (key == "input") {
+      manifest.inputs.push_back(value);
+    } else if (key == "output") {
+      manifest.outputs.push_back(value);
+    }
+  }
+  return manifest;
+}
+
+std::string ManifestFile::format(const OutputManifest &manifest) {
+  std::string text = MANIFEST_VERSION_LINE "\n";
+  for (const std::string &input : manifest.inputs) {
+    text += "input " + input + "\n";
+  }
+  for (const std::string &output : manifest.outputs) {
+    text += "output " + output + "\n";
+  }
+  return text;
+}
+
+std::vector<std::string>
+ManifestFile::inputs(const std::string &cs_file_path,
+                     const ProgramOptions &options) {
+  std::vector<std::string> paths{cs_file_path};
+  if (!options.type_map_path.empty()) {
+    paths.push_back(options.type_map_path);
+  }
+  return paths;
+}
+
+std::vector<std::string>
+ManifestFile::targets(const std::string &directory_name,
+                      const OutputManifest &manifest) {
+  // The manifest goes first: it is the one target every run rewrites
+  std::filesystem::path directory(directory_name);
+  std::vector<std::string> paths{(directory / MANIFEST_FILE_NAME).string()};
+  for (const std::string &output : manifest.outputs) {
+    paths.push_back((directory / output).string());
+  }
+  return paths;
+}
+
+void ManifestFile::write_depfile_rule(
+    std::ostream &out, const std::vector<std::string> &targets,
+    const std::vector<std::string> &prerequisites) {
+  for (std::size_t i = 0; i < targets.size(); i++) {
+    out << (i ? " \\\n  " : "") << escape_path(targets[i]);
+  }
+  out << ":";
+  for (const std::string &prerequisite : prerequisites) {
+    out << " \\\n  " << escape_path(prerequisite);
+  }
+  out << "\n";
+}
+
+void ManifestFile::write_depfile(const std::string &depfile_path,
+                                 const std::string &rules) {
+  std::ofstream file(depfile_path, std::ios::trunc);
+  file << rules;
+  file.close();
+  if (file.fail()) {
+    throw IO_Exception(
+        ("Failed to write the depfile '" + depfile_path + "'").c_str());
+  }
+}
+
+// Spaces and '#' are backslash-escaped and '$' doubled, the way GCC writes
+// -MF depfiles
+std::string ManifestFile::escape_path(const std::string &path) {
+  std::string escaped;
+  for (char c : path) {
+    if (c == ' ' || c == '#') {
+      escaped += '\\';
+    } else if (c == '$') {
+      escaped += '$';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
@@ -0,0 +1,70 @@
+#ifndef OUTPUT_MANIFEST
+#define OUTPUT_MANIFEST
+
+#include "options.hpp"
+#include "output_directory.hpp"
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#define MANIFEST_FILE_NAME "cs_converter.manifest"
+
+// Inputs of one output directory and the exact files generated from them.
+// Stored in the directory as MANIFEST_FILE_NAME, one entry per line:
+//   cs-converter-manifest 1
+//   input <path>        the .cs file, then the type map if any
+//   output <file name>  relative to the directory, sorted
+struct OutputManifest {
+  std::vector<std::string> inputs;
+  std::vector<std::string> outputs;
+};
+
+// What a run changed in the manifest of its output directory
+struct ManifestUpdate {
+  OutputManifest manifest;
+  std::vector<std::string> stale_files; // Listed before, removed now
+};
+
+// Lets a build system see which outputs come from which input: every
+// converted directory gets a manifest, and a depfile can be written with
+// one Make rule per directory. Outputs that an earlier run on the same input
+// generated and this one did not (classes removed from the input) are
+// deleted; files the converter never listed, or listed for another input,
+// are left alone.
+class ManifestFile {
+public:
+  // Lists the files written to the directory so far, removes the stale
+  // ones (when the previous manifest is of the same .cs input) and writes
+  // the new manifest. Call once every output is written
+  // and before OutputDirectory::commit().
+  static ManifestUpdate update(OutputDirectory &directory,
+                               const std::vector<std::string> &inputs);
+
+  // Empty when the directory has no manifest or an unreadable one
+  static OutputManifest read(const OutputDirectory &directory);
+  static OutputManifest parse(std::istream &input);
+  static std::string format(const OutputManifest &manifest);
+
+  // The .cs file and the type map of the options, if any
+  static std::vector<std::string> inputs(const std::string &cs_file_path,
+                                         const ProgramOptions &options);
+  // Paths of the manifest, first, and of every output
+  static std::vector<std::string> targets(const std::string &directory_name,
+                                          const OutputManifest &manifest);
+
+  // "<targets>: <prerequisites>", escaped for Make and Ninja
+  static void write_depfile_rule(std::ostream &out,
+                                 const std::vector<std::string> &targets,
+                                 const std::vector<std::string> &prerequisites);
+  // Writes the rules into a depfile, replacing it
+  static void write_depfile(const std::string &depfile_path,
+                            const std::string &rules);
+
+private:
+  static bool same_input(const OutputManifest &previous,
+                         const OutputManifest &current);
+  static std::string escape_path(const std::string &path);
+};
+
+#endif
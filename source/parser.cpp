@@ -1,5 +1,6 @@
 #include "parser.hpp"
 #include "custom_exceptions.hpp"
+#include "trace.hpp"
 #include <iostream>
 #include <sstream>
 #include <optional>
@@ -54,6 +55,7 @@ bool Parser::isNextTokenEqualTo(const std::string &value) {
 // Parsing functions -----------------------------------
 
 std::vector<ClassNode> Parser::parseProgram() {
+  TraceSpan span("lex and parse");
   std::vector<ClassNode> classes;
   while (!isLastToken()) {
     classes.push_back(parseClassDeclaration());
@@ -62,10 +64,12 @@ std::vector<ClassNode> Parser::parseProgram() {
 }
 
 ClassNode Parser::parseClassDeclaration() {
+  TraceSpan span("lex and parse class");
   ClassNode class_node;
   class_node.access = tryParseAccessModifier();
   expectTokenValue("class");
   class_node.name = parseIdentifier();
+  span.describe("class", class_node.name);
   class_node.base_class = tryParseBaseClass();
   expectTokenValue("{");
   parseMemberDeclarations(class_node);
@@ -269,7 +273,9 @@ std::ostream &operator<<(std::ostream &os, const FieldNode &fieldNode) {
 std::ostream &operator<<(std::ostream &os, const MethodNode &methodNode) {
   if (methodNode.access)
     os << *methodNode.access << " ";
-  os << *methodNode.return_type << " " << methodNode.name << "(";
+  if (methodNode.return_type) // Constructors have none
+    os << *methodNode.return_type << " ";
+  os << methodNode.name << "(";
   for (size_t i = 0; i < methodNode.parameters.size(); ++i) {
     os << methodNode.parameters[i];
     if (i + 1 < methodNode.parameters.size())
@@ -0,0 +1,328 @@
+#include "result_cache.hpp"
+#include "custom_exceptions.hpp"
+#include "hash_utils.hpp"
+#include "output_manifest.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+#define RESULT_CACHE_FORMAT "cs-converter-cache 1"
+// Evicting stops below the limit, so that the next stores do not list the
+// entries again right away
+#define EVICTION_TARGET(limit) ((limit) - (limit) / 10)
+// Left behind by a process killed while storing, removed on eviction
+#define ABANDONED_ENTRY_AGE std::chrono::hours(1)
+
+struct IndexedFile {
+  std::uint64_t size = 0;
+  std::string digest;
+  std::string name;
+};
+
+struct EntryIndex {
+  CachedConversion conversion;
+  std::vector<IndexedFile> files;
+};
+
+static bool read_whole_file(const std::string &path, std::string &content) {
+  std::ifstream file(path, std::ios::binary);
+  if (file.fail()) {
+    return false;
+  }
+  std::ostringstream buffer;
+  buffer << file.rdbuf();
+  content = buffer.str();
+  return !file.bad();
+}
+
+// Read-only, so that an output hard-linked to it is not edited in place
+static void write_entry_file(const std::string &path,
+                             std::string_view content) {
+  int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0444);
+  if (fd < 0) {
+    throw IO_Exception(("Failed to create '" + path + "'").c_str());
+  }
+  std::size_t used = 0;
+  while (used < content.size()) {
+    ssize_t count = ::write(fd, content.data() + used, content.size() - used);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count < 0) {
+      ::close(fd);
+      throw IO_Exception(("Failed to write '" + path + "'").c_str());
+    }
+    used += static_cast<std::size_t>(count);
+  }
+  if (::close(fd) != 0) {
+    throw IO_Exception(("Failed to write '" + path + "'").c_str());
+  }
+}
+
+static bool read_index(const std::string &entry, EntryIndex &index) {
+  std::ifstream input(entry + "/index");
+  std::string line;
+  if (!std::getline(input, line) || line != RESULT_CACHE_FORMAT ||
+      !std::getline(input, line)) {
+    return false;
+  }
+  std::istringstream counts(line);
+  std::string key;
+  if (!(counts >> key >> index.conversion.classes >>
+        index.conversion.members) ||
+      key != "classes") {
+    return false;
+  }
+  while (std::getline(input, line)) {
+    std::istringstream fields(line);
+    IndexedFile file;
+    if (!(fields >> key >> file.size >> file.digest) || key != "file" ||
+        !std::getline(fields >> std::ws, file.name) || file.name.empty() ||
+        file.name.find('/') != std::string::npos) {
+      return false;
+    }
+    index.files.push_back(std::move(file));
+  }
+  return true;
+}
+
+ResultCache::ResultCache(const std::string &directory,
+                         std::uint64_t size_limit_bytes,
+                         const std::string &fingerprint)
+    : directory(directory), size_limit(size_limit_bytes),
+      options_fingerprint(fingerprint) {}
+
+std::string ResultCache::default_directory() {
+  const char *configured = std::getenv("CS_CONVERTER_CACHE");
+  return configured ? configured : "";
+}
+
+std::string ResultCache::fingerprint(const ProgramOptions &options) {
+  std::ostringstream fingerprint;
+  fingerprint << RESULT_CACHE_FORMAT "\nversion " CONVERTER_VERSION
+              << "\npolicy "
+              << static_cast<int>(options.generator.signature_policy)
+              << "\npack " << options.generator.pack_fields << "\nhash "
+              << options.generator.hash_support << "\nunity "
+              << options.unity_units << "\n";
+  if (!options.type_map_path.empty()) {
+    std::string type_map;
+    if (!read_whole_file(options.type_map_path, type_map)) {
+      throw IO_Exception(("Failed to open the type mapping file '" +
+                          options.type_map_path + "'")
+                             .c_str());
+    }
+    fingerprint << "types "
+                << HashUtils::to_hex(HashUtils::fnv1a_64(type_map)) << "\n";
+  }
+  return fingerprint.str();
+}
+
+std::string ResultCache::key(std::string_view source) const {
+  // Two differently seeded passes; a collision still only costs a miss
+  static const std::uint64_t second_seed =
+      HashUtils::fnv1a_64(RESULT_CACHE_FORMAT);
+  std::uint64_t first = HashUtils::fnv1a_64(
+      source, HashUtils::fnv1a_64(options_fingerprint));
+  std::uint64_t second = HashUtils::fnv1a_64(
+      source, HashUtils::fnv1a_64(options_fingerprint, second_seed));
+  return HashUtils::to_hex(first) + HashUtils::to_hex(second);
+}
+
+CachedConversion
+ResultCache::describe(const std::vector<ClassNode> &class_nodes) {
+  CachedConversion conversion;
+  conversion.classes = class_nodes.size();
+  for (const ClassNode &class_node : class_nodes) {
+    conversion.members += class_node.fields.size() +
+                          class_node.methods.size() +
+                          class_node.properties.size();
+  }
+  return conversion;
+}
+
+bool ResultCache::restore(const std::string &key, std::string_view source,
+                          OutputDirectory &output,
+                          CachedConversion &conversion) {
+  TraceSpan span("restore from cache", "file", key);
+  std::string entry = entry_path(key);
+  EntryIndex index;
+  std::string cached_source;
+  if (!read_index(entry, index) ||
+      !read_whole_file(entry + "/source", cached_source) ||
+      cached_source != source) {
+    misses++;
+    return false;
+  }
+
+  std::vector<std::string> contents(index.files.size());
+  for (std::size_t i = 0; i < index.files.size(); i++) {
+    const IndexedFile &file = index.files[i];
+    if (!read_whole_file(entry + "/files/" + file.name, contents[i]) ||
+        contents[i].size() != file.size ||
+        HashUtils::to_hex(HashUtils::fnv1a_64(contents[i])) != file.digest) {
+      misses++;
+      return false;
+    }
+  }
+  try {
+    for (std::size_t i = 0; i < index.files.size(); i++) {
+      output.link_if_changed(index.files[i].name,
+                             entry + "/files/" + index.files[i].name,
+                             contents[i]);
+    }
+  } catch (const IO_Exception &) {
+    misses++; // Evicted meanwhile; converting rewrites every file anyway
+    return false;
+  }
+
+  // Marks the entry as recently used for eviction
+  ::utimensat(AT_FDCWD, (entry + "/index").c_str(), nullptr, 0);
+  conversion = index.conversion;
+  hits++;
+  return true;
+}
+
+void ResultCache::store(const std::string &key, std::string_view source,
+                        const OutputDirectory &output,
+                        const CachedConversion &conversion) {
+  TraceSpan span("store in cache", "file", key);
+  std::string temporary = temporary_path(key);
+  std::error_code error;
+  std::uint64_t entry_size = 0;
+  try {
+    fs::create_directories(temporary + "/files");
+    std::ostringstream index;
+    entry_size = source.size();
+    index << RESULT_CACHE_FORMAT "\nclasses " << conversion.classes << " "
+          << conversion.members << "\n";
+    for (const std::string &file_name : output.file_names()) {
+      std::string content;
+      if (file_name == MANIFEST_FILE_NAME) {
+        continue;
+      }
+      // Still under its temporary name when the commit is deferred
+      if (!read_whole_file(output.content_path(file_name), content)) {
+        throw IO_Exception(
+            ("Failed to read '" + output.file_path(file_name) + "'").c_str());
+      }
+      write_entry_file(temporary + "/files/" + file_name, content);
+      entry_size += content.size();
+      index << "file " << content.size() << " "
+            << HashUtils::to_hex(HashUtils::fnv1a_64(content)) << " "
+            << file_name << "\n";
+    }
+    write_entry_file(temporary + "/source", source);
+    write_entry_file(temporary + "/index", index.str());
+
+    fs::create_directories(directory + "/entries");
+  } catch (const std::exception &) {
+    fs::remove_all(temporary, error);
+    return;
+  }
+
+  // Fails when another process stored the same entry first
+  if (::rename(temporary.c_str(), entry_path(key).c_str()) != 0) {
+    fs::remove_all(temporary, error);
+    return;
+  }
+  stores++;
+  count_stored(entry_size);
+}
+
+ResultCacheStats ResultCache::stats() const {
+  return ResultCacheStats{hits.load(), misses.load(), stores.load(),
+                          evictions.load()};
+}
+
+std::string ResultCache::entry_path(const std::string &key) const {
+  return directory + "/entries/" + key;
+}
+
+// Unique across threads and processes
+std::string ResultCache::temporary_path(const std::string &key) {
+  return directory + "/tmp/" + key + "." + std::to_string(::getpid()) + "." +
+         std::to_string(temporary_count++);
+}
+
+// Lists the entries only when the size is not known yet or the new entry
+// takes it over the limit. Entries other processes store meanwhile are only
+// seen by that next listing.
+void ResultCache::count_stored(std::uint64_t entry_size) {
+  std::lock_guard<std::mutex> lock(size_mutex);
+  if (size_counted && cache_size + entry_size <= size_limit) {
+    cache_size += entry_size;
+    return;
+  }
+  cache_size = evict();
+  size_counted = true;
+}
+
+std::uint64_t ResultCache::evict() {
+  struct Entry {
+    fs::path path;
+    fs::file_time_type last_used;
+    std::uint64_t size = 0;
+  };
+  std::vector<Entry> entries;
+  std::uint64_t total = 0;
+  std::error_code error;
+
+  for (fs::directory_iterator it(directory + "/entries", error), end;
+       !error && it != end; it.increment(error)) {
+    Entry entry{it->path(), {}, 0};
+    EntryIndex index;
+    std::error_code stat_error;
+    entry.last_used = fs::last_write_time(entry.path / "index", stat_error);
+    if (stat_error || !read_index(entry.path.string(), index)) {
+      continue; // Being evicted by another process
+    }
+    entry.size = fs::file_size(entry.path / "source", stat_error);
+    for (const IndexedFile &file : index.files) {
+      entry.size += file.size;
+    }
+    total += entry.size;
+    entries.push_back(std::move(entry));
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) {
+              return a.last_used < b.last_used;
+            });
+  std::uint64_t target =
+      total > size_limit ? EVICTION_TARGET(size_limit) : size_limit;
+  for (const Entry &entry : entries) {
+    if (total <= target) {
+      break;
+    }
+    // Out of entries/ in one rename, then deleted at leisure
+    std::string doomed = temporary_path(entry.path.filename().string());
+    if (::rename(entry.path.c_str(), doomed.c_str()) == 0) {
+      fs::remove_all(doomed, error);
+      evictions++;
+    }
+    total -= entry.size;
+  }
+
+  auto abandoned = fs::file_time_type::clock::now() - ABANDONED_ENTRY_AGE;
+  for (fs::directory_iterator it(directory + "/tmp", error), end;
+       !error && it != end; it.increment(error)) {
+    std::error_code stat_error;
+    if (fs::last_write_time(it->path(), stat_error) < abandoned &&
+        !stat_error) {
+      fs::remove_all(it->path(), stat_error);
+    }
+  }
+  return total;
+}
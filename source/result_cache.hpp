@@ -0,0 +1,101 @@
+#ifndef RESULT_CACHE
+#define RESULT_CACHE
+
+#include "options.hpp"
+#include "output_directory.hpp"
+#include "parser.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Part of every cache key; bump it whenever the same input and options
+// generate different code, so that older entries are no longer hit
+#define CONVERTER_VERSION "1"
+
+// Counted over one run, for the summary and --stats
+struct ResultCacheStats {
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+  std::size_t stores = 0;
+  std::size_t evictions = 0;
+};
+
+// What a hit restored
+struct CachedConversion {
+  std::size_t classes = 0;
+  std::size_t members = 0;
+};
+
+// Content-addressed store of complete output sets, shared by runs, checkouts
+// and processes through a local directory:
+//   <directory>/entries/<key>/index    format line, class counts and one
+//                                      "file <size> <digest> <name>" line
+//                                      per output; its mtime is the last use
+//   <directory>/entries/<key>/source   the input, compared byte for byte on
+//                                      a hit, so that a hash collision is a
+//                                      miss
+//   <directory>/entries/<key>/files/   the outputs, read-only
+// Entries are built under <directory>/tmp and renamed into place, and
+// evicted by renaming them out before deleting them, so a concurrent process
+// sees a complete entry or none; an entry is never modified once published.
+// Hits hard-link the files into the output directory (copies across file
+// systems) after checking their digests. The least recently used entries
+// are evicted once the total exceeds the size limit, down to 90% of it.
+// The total is counted once per process and then kept up to date by the
+// stores of this process, so the entries are only listed again when it
+// crosses the limit.
+class ResultCache {
+public:
+  // Entries are looked up and stored for one fingerprint
+  ResultCache(const std::string &directory, std::uint64_t size_limit_bytes,
+              const std::string &fingerprint);
+
+  // $CS_CONVERTER_CACHE, empty when unset
+  static std::string default_directory();
+
+  // Converter version, the options changing the generated code and the
+  // content of the type map
+  static std::string fingerprint(const ProgramOptions &options);
+  // 128 bits of FNV-1a over the source and the fingerprint, in hex
+  std::string key(std::string_view source) const;
+  static CachedConversion describe(const std::vector<ClassNode> &class_nodes);
+
+  // Links the output set of the entry into the output directory. False on
+  // a miss, including damaged or concurrently evicted entries; the caller
+  // then converts as usual.
+  bool restore(const std::string &key, std::string_view source,
+               OutputDirectory &output, CachedConversion &conversion);
+  // Copies the files produced in the output directory so far (not the manifest)
+  // into a new entry, then evicts if the limit is exceeded. Failures only cost
+  // the entry.
+  void store(const std::string &key, std::string_view source,
+             const OutputDirectory &output,
+             const CachedConversion &conversion);
+
+  ResultCacheStats stats() const;
+
+private:
+  std::string directory;
+  std::uint64_t size_limit;
+  std::string options_fingerprint;
+  std::atomic<std::size_t> hits{0};
+  std::atomic<std::size_t> misses{0};
+  std::atomic<std::size_t> stores{0};
+  std::atomic<std::size_t> evictions{0};
+  std::atomic<std::size_t> temporary_count{0};
+  std::mutex size_mutex;
+  bool size_counted = false; // Whether cache_size was counted yet
+  std::uint64_t cache_size = 0;
+
+  std::string entry_path(const std::string &key) const;
+  std::string temporary_path(const std::string &key);
+  void count_stored(std::uint64_t entry_size);
+  // Returns the total size of the entries left
+  std::uint64_t evict();
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include "run_stats.hpp"
+#include "json_utils.hpp"
+#include <ctime>
+#include <iomanip>
+#include <sys/resource.h>
+
+RunStats::RunStats(bool enabled) : is_enabled(enabled) {
+  if (is_enabled) {
+    run_start = phase_start = std::chrono::steady_clock::now();
+    run_cpu_start = phase_cpu_start = cpu_nanoseconds();
+  }
+}
+
+bool RunStats::enabled() const { return is_enabled; }
+
+void RunStats::end_phase(const std::string &phase) {
+  if (!is_enabled) {
+    return;
+  }
+  auto now = std::chrono::steady_clock::now();
+  std::uint64_t cpu_now = cpu_nanoseconds();
+  phases.push_back(PhaseStats{
+      phase,
+      static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(now -
+                                                               phase_start)
+              .count()),
+      cpu_now - phase_cpu_start});
+  phase_start = now;
+  phase_cpu_start = cpu_now;
+}
+
+LexerStats *RunStats::lexer_stats() { return is_enabled ? &lexer : nullptr; }
+
+void RunStats::count_input(std::uint64_t bytes) { input_bytes += bytes; }
+
+void RunStats::count_classes(const std::vector<ClassNode> &class_nodes) {
+  classes += class_nodes.size();
+  for (const ClassNode &class_node : class_nodes) {
+    members += class_node.fields.size() + class_node.methods.size() +
+               class_node.properties.size();
+  }
+}
+
+void RunStats::count_classes(std::size_t classes, std::size_t members) {
+  this->classes += classes;
+  this->members += members;
+}
+
+void RunStats::count_output(const OutputDirectoryStats &output) {
+  count_files(output.files_written, output.files_unchanged,
+              output.bytes_written);
+  has_output_directory = true;
+  output_directory = output;
+}
+
+void RunStats::count_files(std::size_t written, std::size_t unchanged,
+                           std::uint64_t bytes) {
+  files_written += written;
+  files_unchanged += unchanged;
+  bytes_written += bytes;
+}
+
+void RunStats::count_cache(const ResultCacheStats &cache) {
+  this->cache = cache;
+  has_cache = true;
+}
+
+static double to_milliseconds(std::uint64_t nanoseconds) {
+  return nanoseconds / 1e6;
+}
+
+// Zero when nothing was measured, rather than a division by zero
+static double per_second(double amount, std::uint64_t nanoseconds) {
+  return nanoseconds ? amount * 1e9 / nanoseconds : 0;
+}
+
+void RunStats::write_text(std::ostream &out) const {
+  PhaseStats run = total();
+  out << "\n---------------- STATS ------------------\n\n"
+      << std::fixed << std::setprecision(3) << std::left << std::setw(36)
+      << "phase" << std::right << std::setw(12) << "wall ms" << std::setw(12)
+      << "cpu ms" << "\n";
+  for (const PhaseStats &phase : phases) {
+    out << "- " << std::left << std::setw(34) << phase.phase << std::right
+        << std::setw(12) << to_milliseconds(phase.wall_nanoseconds)
+        << std::setw(12) << to_milliseconds(phase.cpu_nanoseconds) << "\n";
+  }
+  out << "- " << std::left << std::setw(34) << "total" << std::right
+      << std::setw(12) << to_milliseconds(run.wall_nanoseconds)
+      << std::setw(12) << to_milliseconds(run.cpu_nanoseconds) << "\n\n";
+
+  out << std::setprecision(2) << "input: " << input_bytes << " bytes";
+  if (lexer.tokens) {
+    out << ", " << lexer.tokens << " tokens lexed in "
+        << to_milliseconds(lexer.nanoseconds) << " ms ("
+        << per_second(input_bytes, lexer.nanoseconds) / 1e6 << " MB/s, "
+        << per_second(lexer.tokens, lexer.nanoseconds) / 1e6
+        << " M tokens/s)";
+  }
+  out << "\nclasses: " << classes << " with " << members << " members ("
+      << per_second(classes, run.wall_nanoseconds) << " classes/s, "
+      << per_second(members, run.wall_nanoseconds)
+      << " members/s over the whole run)\n"
+      << "output: " << files_written << " files written, " << bytes_written
+      << " bytes, " << files_unchanged << " unchanged\n";
+  if (has_output_directory) {
+    out << "output directory: resolved and opened once in "
+        << to_milliseconds(output_directory.resolve_nanoseconds)
+        << " ms, writes " << to_milliseconds(output_directory.write_nanoseconds)
+        << " ms over all workers, commit (sync and rename) "
+        << to_milliseconds(output_directory.commit_nanoseconds) << " ms\n";
+  }
+  if (has_cache) {
+    out << "result cache: " << cache.hits << " hits, " << cache.misses
+        << " misses, " << cache.stores << " stored, " << cache.evictions
+        << " evicted\n";
+  }
+  out << "peak RSS: " << peak_rss_bytes() / (1024.0 * 1024.0) << " MiB\n";
+  out << std::defaultfloat;
+}
+
+void RunStats::write_json(std::ostream &out) const {
+  PhaseStats run = total();
+  out << std::setprecision(6) << "{\"phases\": [";
+  for (std::size_t i = 0; i < phases.size(); i++) {
+    out << (i ? ", " : "") << "{\"name\": ";
+    JsonUtils::write_string(out, phases[i].phase);
+    out << ", \"wall_ms\": " << to_milliseconds(phases[i].wall_nanoseconds)
+        << ", \"cpu_ms\": " << to_milliseconds(phases[i].cpu_nanoseconds)
+        << "}";
+  }
+  out << "], \"total\": {\"wall_ms\": " << to_milliseconds(run.wall_nanoseconds)
+      << ", \"cpu_ms\": " << to_milliseconds(run.cpu_nanoseconds) << "}"
+      << ", \"input\": {\"bytes\": " << input_bytes
+      << ", \"tokens\": " << lexer.tokens
+      << ", \"lex_ms\": " << to_milliseconds(lexer.nanoseconds)
+      << ", \"bytes_per_second\": "
+      << per_second(input_bytes, lexer.nanoseconds)
+      << ", \"tokens_per_second\": "
+      << per_second(lexer.tokens, lexer.nanoseconds) << "}"
+      << ", \"classes\": " << classes << ", \"members\": " << members
+      << ", \"classes_per_second\": "
+      << per_second(classes, run.wall_nanoseconds)
+      << ", \"members_per_second\": "
+      << per_second(members, run.wall_nanoseconds)
+      << ", \"output\": {\"files_written\": " << files_written
+      << ", \"files_unchanged\": " << files_unchanged
+      << ", \"bytes_written\": " << bytes_written;
+  if (has_output_directory) {
+    out << ", \"resolve_ms\": "
+        << to_milliseconds(output_directory.resolve_nanoseconds)
+        << ", \"write_ms\": "
+        << to_milliseconds(output_directory.write_nanoseconds)
+        << ", \"commit_ms\": "
+        << to_milliseconds(output_directory.commit_nanoseconds);
+  }
+  out << "}";
+  if (has_cache) {
+    out << ", \"cache\": {\"hits\": " << cache.hits
+        << ", \"misses\": " << cache.misses << ", \"stores\": " << cache.stores
+        << ", \"evictions\": " << cache.evictions << "}";
+  }
+  out << ", \"peak_rss_bytes\": " << peak_rss_bytes() << "}\n"
+      << std::defaultfloat;
+}
+
+std::uint64_t RunStats::peak_rss_bytes() {
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024; // KiB on Linux
+}
+
+std::uint64_t RunStats::cpu_nanoseconds() {
+  timespec now{};
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return static_cast<std::uint64_t>(now.tv_sec) * 1000000000ULL +
+         static_cast<std::uint64_t>(now.tv_nsec);
+}
+
+PhaseStats RunStats::total() const {
+  if (!is_enabled) {
+    return PhaseStats{"total"};
+  }
+  auto end = phases.empty() ? run_start : phase_start;
+  return PhaseStats{
+      "total",
+      static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(end - run_start)
+              .count()),
+      (phases.empty() ? run_cpu_start : phase_cpu_start) - run_cpu_start};
+}
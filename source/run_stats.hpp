@@ -0,0 +1,74 @@
+#ifndef RUN_STATS
+#define RUN_STATS
+
+#include "lexer.hpp"
+#include "output_directory.hpp"
+#include "parser.hpp"
+#include "result_cache.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Wall-clock (steady clock) and CPU time (of the whole process, all
+// threads) spent in one phase
+struct PhaseStats {
+  std::string phase;
+  std::uint64_t wall_nanoseconds = 0;
+  std::uint64_t cpu_nanoseconds = 0;
+};
+
+// Figures behind --stats. A disabled instance records nothing, so the
+// report costs nothing unless asked for; counters are filled in by the
+// caller and the lexer.
+class RunStats {
+public:
+  explicit RunStats(bool enabled);
+
+  bool enabled() const;
+  // Ends the current phase and starts the next one
+  void end_phase(const std::string &phase);
+
+  // Handed to the lexer when enabled, nullptr otherwise
+  LexerStats *lexer_stats();
+  void count_input(std::uint64_t bytes);
+  void count_classes(const std::vector<ClassNode> &class_nodes);
+  void count_classes(std::size_t classes, std::size_t members);
+  // Output written through one directory, with its timings
+  void count_output(const OutputDirectoryStats &output);
+  // Output written some other way (bundles, several directories)
+  void count_files(std::size_t written, std::size_t unchanged,
+                   std::uint64_t bytes);
+  void count_cache(const ResultCacheStats &cache);
+
+  void write_text(std::ostream &out) const;
+  void write_json(std::ostream &out) const;
+
+  // Largest resident set of the process so far
+  static std::uint64_t peak_rss_bytes();
+
+private:
+  bool is_enabled;
+  std::chrono::steady_clock::time_point run_start, phase_start;
+  std::uint64_t run_cpu_start = 0, phase_cpu_start = 0;
+  std::vector<PhaseStats> phases;
+
+  LexerStats lexer;
+  std::uint64_t input_bytes = 0;
+  std::size_t classes = 0;
+  std::size_t members = 0;
+  std::size_t files_written = 0;
+  std::size_t files_unchanged = 0;
+  std::uint64_t bytes_written = 0;
+  bool has_output_directory = false;
+  OutputDirectoryStats output_directory;
+  bool has_cache = false;
+  ResultCacheStats cache;
+
+  static std::uint64_t cpu_nanoseconds();
+  PhaseStats total() const;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+ThreadPool::ThreadPool(std::size_t worker_count) {
+  workers.reserve(worker_count);
+  for (std::size_t i = 0; i < worker_count; i++) {
+    workers.emplace_back(&ThreadPool::worker_loop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    stopping = true;
+  }
+  tasks_available.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+std::size_t ThreadPool::size() const { return workers.size(); }
+
+std::size_t ThreadPool::default_worker_count() {
+  unsigned int cores = std::thread::hardware_concurrency();
+  return cores == 0 ? 1 : cores;
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+  if (workers.empty()) {
+    task(); // Inline pool
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    tasks.push(std::move(task));
+  }
+  tasks_available.notify_one();
+}
+
+void ThreadPool::worker_loop(std::size_t index) {
+  Trace::name_thread("pool worker " + std::to_string(index));
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(tasks_mutex);
+      tasks_available.wait(lock,
+                           [this]() { return stopping || !tasks.empty(); });
+      if (tasks.empty()) {
+        return; // Only leave once every queued task has run
+      }
+      task = std::move(tasks.front());
+      tasks.pop();
+    }
+    task();
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef THREAD_POOL
+#define THREAD_POOL
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads consuming a shared FIFO task queue
+class ThreadPool {
+public:
+  // Without workers, tasks run on the submitting thread before submit()
+  // returns (for callers that are already parallel)
+  explicit ThreadPool(std::size_t worker_count);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Queues a task; exceptions thrown by it are rethrown by future::get()
+  template <typename Function>
+  auto submit(Function function) -> std::future<decltype(function())> {
+    using Result = decltype(function());
+    auto task =
+        std::make_shared<std::packaged_task<Result()>>(std::move(function));
+    std::future<Result> result = task->get_future();
+    enqueue([task]() { (*task)(); });
+    return result;
+  }
+
+  std::size_t size() const;
+  static std::size_t default_worker_count();
+
+private:
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex tasks_mutex;
+  std::condition_variable tasks_available;
+  bool stopping = false;
+
+  void enqueue(std::function<void()> task);
+  void worker_loop(std::size_t index);
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "trace.hpp"
+#include "json_utils.hpp"
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <unistd.h>
+#include <vector>
+
+TraceBuffer::TraceBuffer(std::size_t thread_index) : index(thread_index) {}
+
+TraceBuffer::~TraceBuffer() {
+  Chunk *chunk = first.next.load(std::memory_order_relaxed);
+  while (chunk) {
+    Chunk *next = chunk->next.load(std::memory_order_relaxed);
+    delete chunk;
+    chunk = next;
+  }
+}
+
+void TraceBuffer::append(TraceEvent event) {
+  std::size_t count = last->count.load(std::memory_order_relaxed);
+  if (count == CHUNK_EVENTS) {
+    Chunk *chunk = new Chunk();
+    last->next.store(chunk, std::memory_order_release);
+    last = chunk;
+    count = 0;
+  }
+  last->events[count] = std::move(event);
+  last->count.store(count + 1, std::memory_order_release);
+}
+
+std::size_t TraceBuffer::thread_index() const { return index; }
+
+std::atomic<bool> Trace::active{false};
+
+// Buffers live until the process exits, so that the events of finished
+// threads can still be written
+static std::mutex registry_mutex;
+static std::vector<std::unique_ptr<TraceBuffer>> registry;
+static std::atomic<std::int64_t> epoch{0};
+static thread_local TraceBuffer *current_buffer = nullptr;
+static thread_local std::string current_thread_name;
+
+static std::uint64_t nanoseconds_since_start() {
+  std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now().time_since_epoch())
+                         .count();
+  return static_cast<std::uint64_t>(now -
+                                    epoch.load(std::memory_order_relaxed));
+}
+
+void Trace::start() {
+  epoch.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now().time_since_epoch())
+                  .count(),
+              std::memory_order_relaxed);
+  active.store(true, std::memory_order_release);
+}
+
+void Trace::stop() { active.store(false, std::memory_order_release); }
+
+void Trace::name_thread(const std::string &name) {
+  current_thread_name = name;
+}
+
+TraceBuffer &Trace::thread_buffer() {
+  if (!current_buffer) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.push_back(std::make_unique<TraceBuffer>(registry.size()));
+    current_buffer = registry.back().get();
+    current_buffer->thread_name =
+        current_thread_name.empty()
+            ? "thread " + std::to_string(current_buffer->thread_index())
+            : current_thread_name;
+  }
+  return *current_buffer;
+}
+
+void Trace::begin(const char *name, const char *subject_kind,
+                  const std::string &subject) {
+  thread_buffer().append(TraceEvent{nanoseconds_since_start(), name,
+                                    subject_kind, subject, 'B'});
+}
+
+void Trace::end(const char *name, const char *subject_kind,
+                const std::string &subject) {
+  thread_buffer().append(TraceEvent{nanoseconds_since_start(), name,
+                                    subject_kind, subject, 'E'});
+}
+
+void Trace::write_json(std::ostream &out) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  const pid_t pid = getpid();
+  bool first = true;
+
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  for (const std::unique_ptr<TraceBuffer> &buffer : registry) {
+    out << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": "
+        << "\"M\", \"pid\": " << pid << ", \"tid\": " << buffer->thread_index()
+        << ", \"args\": {\"name\": ";
+    JsonUtils::write_string(out, buffer->thread_name);
+    out << "}}";
+    first = false;
+
+    buffer->for_each([&](const TraceEvent &event) {
+      // Microseconds, as the format expects, with nanosecond precision
+      out << ",\n{\"name\": \"" << event.name << "\", \"cat\": \"convert\", "
+          << "\"ph\": \"" << event.phase << "\", \"ts\": "
+          << event.nanoseconds / 1000 << '.' << std::setw(3)
+          << std::setfill('0') << event.nanoseconds % 1000
+          << std::setfill(' ') << ", \"pid\": " << pid
+          << ", \"tid\": " << buffer->thread_index();
+      if (event.subject_kind) {
+        out << ", \"args\": {\"" << event.subject_kind << "\": ";
+        JsonUtils::write_string(out, event.subject);
+        out << "}";
+      }
+      out << "}";
+    });
+  }
+  out << "\n]}\n";
+}
+
+TraceSpan::TraceSpan(const char *name, const char *subject_kind,
+                     const std::string &subject)
+    : name(name), recording(Trace::enabled()) {
+  if (recording) {
+    Trace::begin(name, subject_kind, subject);
+  }
+}
+
+TraceSpan::~TraceSpan() {
+  if (recording) {
+    Trace::end(name, late_kind, late_subject);
+  }
+}
+
+void TraceSpan::describe(const char *subject_kind,
+                         const std::string &subject) {
+  if (recording) {
+    late_kind = subject_kind;
+    late_subject = subject;
+  }
+}
@@ -0,0 +1,108 @@
+#ifndef TRACE
+#define TRACE
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+
+// One begin or end of a span. The subject is what the span works on, shown
+// as its argument in the viewer: {"class": "Foo"}.
+struct TraceEvent {
+  std::uint64_t nanoseconds = 0; // Since Trace::start()
+  const char *name = nullptr;
+  const char *subject_kind = nullptr; // "file", "class"; no argument if null
+  std::string subject;
+  char phase = 'B'; // 'B' begins a span, 'E' ends the innermost one
+};
+
+// Events of one thread, appended by that thread only. Chunks are never moved
+// or freed while tracing, so a reader only needs the published counts.
+class TraceBuffer {
+public:
+  explicit TraceBuffer(std::size_t thread_index);
+  ~TraceBuffer();
+
+  TraceBuffer(const TraceBuffer &) = delete;
+  TraceBuffer &operator=(const TraceBuffer &) = delete;
+
+  void append(TraceEvent event);
+  // Calls visit for every published event, oldest first
+  template <typename Visit> void for_each(Visit visit) const {
+    for (const Chunk *chunk = &first; chunk;
+         chunk = chunk->next.load(std::memory_order_acquire)) {
+      std::size_t count = chunk->count.load(std::memory_order_acquire);
+      for (std::size_t i = 0; i < count; i++) {
+        visit(chunk->events[i]);
+      }
+    }
+  }
+
+  std::size_t thread_index() const;
+  std::string thread_name;
+
+private:
+  static constexpr std::size_t CHUNK_EVENTS = 1024;
+  struct Chunk {
+    TraceEvent events[CHUNK_EVENTS];
+    std::atomic<std::size_t> count{0};
+    std::atomic<Chunk *> next{nullptr};
+  };
+
+  std::size_t index;
+  Chunk first;
+  Chunk *last = &first;
+};
+
+// Process-wide span recorder behind --trace. Every thread appends to its own
+// buffer without locking (the registry lock is taken once per thread, on
+// its first event); the result is written as Chrome trace-event JSON, which
+// chrome://tracing and Perfetto load. While disabled a span costs one
+// relaxed atomic load.
+class Trace {
+public:
+  static void start();
+  static void stop();
+  static bool enabled() { return active.load(std::memory_order_relaxed); }
+
+  // Shown instead of "thread N"; takes effect before the thread's first
+  // event and costs nothing while disabled
+  static void name_thread(const std::string &name);
+
+  static void begin(const char *name, const char *subject_kind,
+                    const std::string &subject);
+  static void end(const char *name, const char *subject_kind,
+                  const std::string &subject);
+
+  // Only complete once the traced threads finished their spans
+  static void write_json(std::ostream &out);
+
+private:
+  static std::atomic<bool> active;
+  static TraceBuffer &thread_buffer();
+};
+
+// Records a span for its lifetime when tracing is enabled
+class TraceSpan {
+public:
+  TraceSpan(const char *name, const char *subject_kind = nullptr,
+            const std::string &subject = std::string());
+  ~TraceSpan();
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+  // For subjects only known once the work started, recorded on the end
+  // event (the viewer merges the arguments of both)
+  void describe(const char *subject_kind, const std::string &subject);
+
+private:
+  const char *name;
+  bool recording;
+  const char *late_kind = nullptr;
+  std::string late_subject;
+};
+
+#endif
@@ -0,0 +1,212 @@
+#include "type_table.hpp"
+#include "custom_exceptions.hpp"
+#include "hash_utils.hpp"
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+
+#define SIZE_OF(type) sizeof(type), alignof(type)
+
+TypeTable::TypeTable() {
+  add("int", {"int", "", false, SIZE_OF(int)});
+  add("float", {"float", "", false, SIZE_OF(float)});
+  add("double", {"double", "", false, SIZE_OF(double)});
+  add("bool", {"bool", "", false, SIZE_OF(bool)});
+  add("void", {"void", "", false, 0, 0});
+  add("string", {"std::string", "<string>", true, SIZE_OF(std::string)});
+  add("Object", {"Object", "", false, 0, 0});
+}
+
+// Layout of the C++ types a mapping can name without giving one
+static void set_known_layout(TypeMapping &mapping) {
+  static const std::unordered_map<std::string,
+                                  std::pair<std::size_t, std::size_t>>
+      known_layouts = {
+          {"bool", {SIZE_OF(bool)}},
+          {"char", {SIZE_OF(char)}},
+          {"signed char", {SIZE_OF(signed char)}},
+          {"unsigned char", {SIZE_OF(unsigned char)}},
+          {"wchar_t", {SIZE_OF(wchar_t)}},
+          {"char16_t", {SIZE_OF(char16_t)}},
+          {"char32_t", {SIZE_OF(char32_t)}},
+          {"short", {SIZE_OF(short)}},
+          {"unsigned short", {SIZE_OF(unsigned short)}},
+          {"int", {SIZE_OF(int)}},
+          {"unsigned", {SIZE_OF(unsigned)}},
+          {"unsigned int", {SIZE_OF(unsigned int)}},
+          {"long", {SIZE_OF(long)}},
+          {"unsigned long", {SIZE_OF(unsigned long)}},
+          {"long long", {SIZE_OF(long long)}},
+          {"unsigned long long", {SIZE_OF(unsigned long long)}},
+          {"float", {SIZE_OF(float)}},
+          {"double", {SIZE_OF(double)}},
+          {"long double", {SIZE_OF(long double)}},
+          {"std::int8_t", {SIZE_OF(std::int8_t)}},
+          {"std::uint8_t", {SIZE_OF(std::uint8_t)}},
+          {"std::int16_t", {SIZE_OF(std::int16_t)}},
+          {"std::uint16_t", {SIZE_OF(std::uint16_t)}},
+          {"std::int32_t", {SIZE_OF(std::int32_t)}},
+          {"std::uint32_t", {SIZE_OF(std::uint32_t)}},
+          {"std::int64_t", {SIZE_OF(std::int64_t)}},
+          {"std::uint64_t", {SIZE_OF(std::uint64_t)}},
+          {"std::size_t", {SIZE_OF(std::size_t)}},
+          {"std::ptrdiff_t", {SIZE_OF(std::ptrdiff_t)}},
+          {"std::string", {SIZE_OF(std::string)}},
+          {"std::string_view", {SIZE_OF(std::string_view)}},
+          {"std::wstring", {SIZE_OF(std::wstring)}}};
+
+  auto known = known_layouts.find(mapping.cpp_type);
+  if (known != known_layouts.end()) {
+    mapping.size = known->second.first;
+    mapping.alignment = known->second.second;
+  }
+}
+
+TypeTable TypeTable::load(const std::string &path) {
+  std::ifstream input{path};
+  if (input.fail()) {
+    throw IO_Exception(
+        ("Failed to open the type mapping file '" + path + "'").c_str());
+  }
+  return parse(input, path);
+}
+
+TypeTable TypeTable::parse(std::istream &input,
+                           const std::string &source_name) {
+  TypeTable table;
+  std::string line;
+  for (int line_number = 1; std::getline(input, line); line_number++) {
+    std::size_t comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.erase(comment);
+    }
+
+    std::istringstream tokens{line};
+    std::string cs_type, token;
+    TypeMapping mapping;
+    if (!(tokens >> cs_type)) {
+      continue; // Blank or comment-only line
+    }
+    auto fail = [&](const std::string &reason) {
+      throw IO_Exception((source_name + ":" + std::to_string(line_number) +
+                          ": " + reason)
+                             .c_str());
+    };
+    if (!(tokens >> mapping.cpp_type)) {
+      fail("missing C++ type for '" + cs_type + "'");
+    }
+    auto parse_bytes = [&](const std::string &value) -> std::size_t {
+      if (value.empty() ||
+          value.find_first_not_of("0123456789") != std::string::npos ||
+          value.size() > 9 || std::stoul(value) == 0) {
+        fail("invalid '" + token + "' in mapping for '" + cs_type + "'");
+      }
+      return std::stoul(value);
+    };
+    set_known_layout(mapping);
+    bool sized = false, aligned = false;
+    while (tokens >> token) {
+      if (token.rfind("size=", 0) == 0) {
+        mapping.size = parse_bytes(token.substr(5));
+        sized = true;
+      } else if (token.rfind("align=", 0) == 0) {
+        mapping.alignment = parse_bytes(token.substr(6));
+        aligned = true;
+      } else if (token == "by-value") {
+        mapping.passed_by_reference = false;
+      } else if (token == "by-reference") {
+        mapping.passed_by_reference = true;
+      } else if (mapping.header.empty() &&
+                 ((token.front() == '<' && token.back() == '>') ||
+                  (token.size() > 1 && token.front() == '"' &&
+                   token.back() == '"'))) {
+        mapping.header = token;
+      } else {
+        fail("unexpected '" + token + "' in mapping for '" + cs_type + "'");
+      }
+    }
+    if (sized != aligned) {
+      fail("size= and align= go together in mapping for '" + cs_type + "'");
+    }
+    if (mapping.alignment & (mapping.alignment - 1)) {
+      fail("alignment of '" + cs_type + "' is not a power of two");
+    }
+    table.add(cs_type, mapping);
+  }
+  if (input.bad()) {
+    throw IO_Exception(
+        ("Failed while reading the type mapping file '" + source_name + "'")
+            .c_str());
+  }
+  return table;
+}
+
+// A later mapping for the same C# type replaces the earlier one
+void TypeTable::add(const std::string &cs_type, const TypeMapping &mapping) {
+  if ((entries.size() + 1) * 2 > slots.size()) {
+    rehash(slots.empty() ? 16 : slots.size() * 2);
+  }
+
+  std::uint64_t hash = HashUtils::fnv1a_64(cs_type);
+  Slot &slot = slots[slot_index(cs_type, hash)];
+  if (slot.entry != EMPTY_SLOT) {
+    entries[slot.entry].second = mapping;
+    return;
+  }
+  slot = Slot{hash, static_cast<std::uint32_t>(entries.size())};
+  entries.emplace_back(cs_type, mapping);
+}
+
+const TypeMapping *TypeTable::find(const std::string &cs_type) const {
+  const Slot &slot =
+      slots[slot_index(cs_type, HashUtils::fnv1a_64(cs_type))];
+  return slot.entry == EMPTY_SLOT ? nullptr : &entries[slot.entry].second;
+}
+
+bool TypeTable::contains(const std::string &cs_type) const {
+  return find(cs_type) != nullptr;
+}
+
+std::size_t TypeTable::size() const { return entries.size(); }
+
+const TypeTable &TypeTable::active() { return active_storage(); }
+
+void TypeTable::install(TypeTable table) {
+  active_storage() = std::move(table);
+}
+
+// Slot holding cs_type, or the empty slot where it would be inserted.
+// Linear probing; the table is never more than half full.
+std::size_t TypeTable::slot_index(const std::string &cs_type,
+                                  std::uint64_t hash) const {
+  std::size_t mask = slots.size() - 1;
+  for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+    const Slot &slot = slots[i];
+    if (slot.entry == EMPTY_SLOT ||
+        (slot.hash == hash && entries[slot.entry].first == cs_type)) {
+      return i;
+    }
+  }
+}
+
+void TypeTable::rehash(std::size_t slot_count) {
+  std::vector<Slot> old_slots = std::move(slots);
+  slots.assign(slot_count, Slot{0, EMPTY_SLOT});
+  std::size_t mask = slot_count - 1;
+  for (const Slot &slot : old_slots) {
+    if (slot.entry == EMPTY_SLOT)
+      continue;
+    std::size_t i = slot.hash & mask;
+    while (slots[i].entry != EMPTY_SLOT) {
+      i = (i + 1) & mask;
+    }
+    slots[i] = slot;
+  }
+}
+
+TypeTable &TypeTable::active_storage() {
+  static TypeTable table;
+  return table;
+}
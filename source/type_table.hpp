@@ -0,0 +1,68 @@
+#ifndef TYPE_TABLE
+#define TYPE_TABLE
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// C++ spelling of a C# type
+struct TypeMapping {
+  std::string cpp_type;
+  std::string header; // Include target ("<cstdint>", "\"money.hpp\""), or empty
+  bool passed_by_reference = false; // Taken by const& under the performance
+                                    // emission policy
+  // Layout of the C++ type for --pack-fields, 0 when unknown (estimated as
+  // pointer-sized)
+  std::size_t size = 0;
+  std::size_t alignment = 0;
+};
+
+// Mappings from C# type names to C++ types. Built-in types are always
+// present, a mapping file adds to (or overrides) them. Lookups hash the name
+// once and probe a flat open-addressing table, so their cost does not depend
+// on the number of mappings.
+//
+// Mapping file format, one mapping per line, '#' starts a comment:
+//   <C# type> <C++ type> [<header>] [by-value|by-reference]
+//                        [size=<bytes> align=<bytes>]
+// e.g. "long std::int64_t <cstdint>" or "Money acme::Money "acme/money.hpp"
+// by-reference size=16 align=8". The layout of fundamental, <cstdint> and
+// standard string types is known without size= and align=.
+class TypeTable {
+public:
+  TypeTable(); // Built-in types only
+
+  static TypeTable load(const std::string &path);
+  static TypeTable parse(std::istream &input, const std::string &source_name);
+
+  void add(const std::string &cs_type, const TypeMapping &mapping);
+  const TypeMapping *find(const std::string &cs_type) const;
+  bool contains(const std::string &cs_type) const;
+  std::size_t size() const;
+
+  // Table queried by the validator and the code generator. Install it once
+  // at start-up, before any generation thread runs; it is read-only after.
+  static const TypeTable &active();
+  static void install(TypeTable table);
+
+private:
+  static constexpr std::uint32_t EMPTY_SLOT = UINT32_MAX;
+
+  struct Slot {
+    std::uint64_t hash;
+    std::uint32_t entry; // Index into entries, EMPTY_SLOT if unused
+  };
+
+  std::vector<std::pair<std::string, TypeMapping>> entries;
+  std::vector<Slot> slots; // Power of two sized, at most half full
+
+  std::size_t slot_index(const std::string &cs_type,
+                         std::uint64_t hash) const;
+  void rehash(std::size_t slot_count);
+  static TypeTable &active_storage();
+};
+
+#endif
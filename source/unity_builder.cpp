@@ -0,0 +1,203 @@
+#include "unity_builder.hpp"
+#include "code_generator.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <queue>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+
+UnityOutput UnityBuilder::build(const std::vector<ClassNode> &class_nodes,
+                                std::size_t unit_count,
+                                const GeneratorOptions &options,
+                                ThreadPool &pool) {
+  // Render declarations and definitions of every class in parallel
+  std::vector<std::future<std::pair<std::string, std::string>>> pending;
+  pending.reserve(class_nodes.size());
+  for (const ClassNode &class_node : class_nodes) {
+    pending.push_back(pool.submit([&class_node, &options]() {
+      TraceSpan span("generate", "class", class_node.name);
+      std::ostringstream declaration, definitions;
+      CodeGenerator::generate_class_declaration(class_node, declaration,
+                                                options);
+      CodeGenerator::generate_source_body(class_node, definitions, options);
+      return std::make_pair(declaration.str(), definitions.str());
+    }));
+  }
+
+  std::vector<std::string> declarations, definitions;
+  std::vector<std::size_t> sizes;
+  for (auto &result : pending) {
+    auto [declaration, definition] = result.get();
+    declarations.push_back(std::move(declaration));
+    sizes.push_back(definition.size());
+    definitions.push_back(std::move(definition));
+  }
+
+  UnityOutput output;
+
+  // Aggregate header: forward declarations let methods refer to any class,
+  // the class bodies follow in dependency order
+  std::ostringstream header;
+  std::set<std::string> standard_headers;
+  for (const ClassNode &class_node : class_nodes) {
+    std::set<std::string> headers =
+        CodeGenerator::required_standard_headers(class_node, options);
+    standard_headers.insert(headers.begin(), headers.end());
+  }
+  header << "#pragma once\n";
+  for (const std::string &standard_header : standard_headers) {
+    header << "#include " << standard_header << "\n";
+  }
+  header << "\n";
+  for (const ClassNode &class_node : class_nodes) {
+    header << "class " << class_node.name << ";\n";
+  }
+  for (std::size_t index : dependency_order(class_nodes)) {
+    header << "\n" << declarations[index];
+  }
+  output.header = header.str();
+
+  for (const std::vector<std::size_t> &group :
+       balance_by_size(sizes, unit_count)) {
+    std::string unit = "#include \"" UNITY_HEADER_NAME "\"\n";
+    for (std::size_t index : group) {
+      unit += "\n" + definitions[index];
+    }
+    output.units.push_back(std::move(unit));
+  }
+
+  return output;
+}
+
+UnityFiles UnityBuilder::write(const UnityOutput &output,
+                               OutputDirectory &directory) {
+  UnityFiles files;
+
+  auto write_file = [&](const std::string &file_name,
+                        const std::string &content) {
+    if (directory.write_if_changed(file_name, content)) {
+      files.written++;
+    } else {
+      files.unchanged++;
+    }
+    files.paths.push_back(directory.file_path(file_name));
+  };
+
+  write_file(UNITY_HEADER_NAME, output.header);
+  for (std::size_t i = 0; i < output.units.size(); i++) {
+    write_file(unit_file_name(i), output.units[i]);
+  }
+  return files;
+}
+
+std::vector<std::size_t>
+UnityBuilder::dependency_order(const std::vector<ClassNode> &class_nodes) {
+  std::unordered_map<std::string, std::size_t> index_by_name;
+  for (std::size_t i = 0; i < class_nodes.size(); i++) {
+    index_by_name.emplace(class_nodes[i].name, i);
+  }
+
+  auto dependencies_of = [&](std::size_t index) {
+    const ClassNode &class_node = class_nodes[index];
+    std::vector<std::size_t> dependencies;
+    auto add = [&](const std::string &type) {
+      auto it = index_by_name.find(type);
+      if (it != index_by_name.end() && it->second != index) {
+        dependencies.push_back(it->second);
+      }
+    };
+    if (class_node.base_class)
+      add(*class_node.base_class);
+    for (const FieldNode &field : class_node.fields)
+      add(field.type);
+    for (const PropertyNode &property : class_node.properties)
+      add(property.type);
+    return dependencies;
+  };
+
+  // Iterative depth-first post-order, so long inheritance chains cannot
+  // overflow the stack. Cycles (rejected by any C++ compiler anyway) are
+  // broken by ignoring edges back to a class still being visited.
+  enum class State { Unvisited, Visiting, Done };
+  struct Frame {
+    std::size_t index;
+    std::vector<std::size_t> dependencies;
+    std::size_t next = 0;
+  };
+
+  std::vector<State> state(class_nodes.size(), State::Unvisited);
+  std::vector<std::size_t> order;
+  order.reserve(class_nodes.size());
+
+  for (std::size_t root = 0; root < class_nodes.size(); root++) {
+    if (state[root] != State::Unvisited)
+      continue;
+
+    std::vector<Frame> stack;
+    stack.push_back(Frame{root, dependencies_of(root)});
+    state[root] = State::Visiting;
+
+    while (!stack.empty()) {
+      Frame &frame = stack.back();
+      if (frame.next < frame.dependencies.size()) {
+        std::size_t dependency = frame.dependencies[frame.next++];
+        if (state[dependency] == State::Unvisited) {
+          state[dependency] = State::Visiting;
+          stack.push_back(Frame{dependency, dependencies_of(dependency)});
+        }
+      } else {
+        state[frame.index] = State::Done;
+        order.push_back(frame.index);
+        stack.pop_back();
+      }
+    }
+  }
+
+  return order;
+}
+
+std::vector<std::vector<std::size_t>>
+UnityBuilder::balance_by_size(const std::vector<std::size_t> &sizes,
+                              std::size_t unit_count) {
+  unit_count = std::min(unit_count, sizes.size());
+  if (unit_count == 0) {
+    return {};
+  }
+
+  // Largest first, each item into the currently smallest group
+  std::vector<std::size_t> by_size(sizes.size());
+  for (std::size_t i = 0; i < by_size.size(); i++) {
+    by_size[i] = i;
+  }
+  std::stable_sort(by_size.begin(), by_size.end(),
+                   [&sizes](std::size_t a, std::size_t b) {
+                     return sizes[a] > sizes[b];
+                   });
+
+  using Load = std::pair<std::size_t, std::size_t>; // (total size, group)
+  std::priority_queue<Load, std::vector<Load>, std::greater<Load>> loads;
+  for (std::size_t group = 0; group < unit_count; group++) {
+    loads.push({0, group});
+  }
+
+  std::vector<std::vector<std::size_t>> groups(unit_count);
+  for (std::size_t index : by_size) {
+    auto [total, group] = loads.top();
+    loads.pop();
+    groups[group].push_back(index);
+    loads.push({total + sizes[index], group});
+  }
+
+  for (std::vector<std::size_t> &group : groups) {
+    std::sort(group.begin(), group.end());
+  }
+  return groups;
+}
+
+std::string UnityBuilder::unit_file_name(std::size_t unit_index) {
+  return "unity_" + std::to_string(unit_index) + ".cpp";
+}
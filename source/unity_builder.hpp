@@ -0,0 +1,50 @@
+#ifndef UNITY_BUILDER
+#define UNITY_BUILDER
+
+#include "code_generator.hpp"
+#include "output_directory.hpp"
+#include "parser.hpp"
+#include "thread_pool.hpp"
+#include <string>
+#include <vector>
+
+#define UNITY_HEADER_NAME "generated_classes.hpp"
+
+// Unity ("jumbo") output: one aggregate header declaring every class and a
+// fixed number of translation units, each holding the definitions of several
+// classes, instead of one .hpp/.cpp pair per class.
+struct UnityOutput {
+  std::string header;
+  std::vector<std::string> units;
+};
+
+struct UnityFiles {
+  std::vector<std::string> paths; // Aggregate header first, then the units
+  int written = 0;
+  int unchanged = 0;
+};
+
+class UnityBuilder {
+public:
+  static UnityOutput build(const std::vector<ClassNode> &class_nodes,
+                           std::size_t unit_count,
+                           const GeneratorOptions &options, ThreadPool &pool);
+  static UnityFiles write(const UnityOutput &output,
+                          OutputDirectory &directory);
+
+  // Class indices ordered so that every class comes after the classes it
+  // needs as complete types (base class, by-value fields and properties),
+  // keeping declaration order otherwise.
+  static std::vector<std::size_t>
+  dependency_order(const std::vector<ClassNode> &class_nodes);
+
+  // Splits items into at most unit_count groups of similar total size,
+  // each group listing its items in ascending index order
+  static std::vector<std::vector<std::size_t>>
+  balance_by_size(const std::vector<std::size_t> &sizes,
+                  std::size_t unit_count);
+
+  static std::string unit_file_name(std::size_t unit_index);
+};
+
+#endif
@@ -1,14 +1,19 @@
 #include "validator.hpp"
 #include "custom_exceptions.hpp"
+#include "trace.hpp"
+#include "type_table.hpp"
 #include <unordered_set>
 
 void Validator::ensure_valid_structure(std::vector<ClassNode> &classes) {
+  TraceSpan span("validate");
   for (const auto &specific_class : classes) {
+    TraceSpan class_span("validate class", "class", specific_class.name);
     ensure_no_field_duplicate_within_class(specific_class);
     ensure_no_property_duplicate_within_class(specific_class);
     ensure_no_method_duplicate_within_class(specific_class);
   }
 
+  TraceSpan hierarchy_span("validate hierarchy and types");
   ensure_class_hierarchy(classes);
   ensure_user_defined_types(classes);
 }
@@ -102,15 +107,13 @@ void Validator::ensure_user_defined_types(const std::vector<ClassNode>& classes)
     defined_class_names.insert(specific_class.name);
   }
 
-  
-  const std::unordered_set<std::string> primitive_types = {
-    "int", "float", "double", "bool", "void", "string", "Object"
-  };
+  // Built-in and mapped types, shared with the code generator
+  const TypeTable& type_table = TypeTable::active();
 
   for (const auto& specific_class : classes) {
     for (const auto& field : specific_class.fields) {
       const std::string& type = field.type;
-      if (primitive_types.find(type) == primitive_types.end() &&
+      if (!type_table.contains(type) &&
           defined_class_names.find(type) == defined_class_names.end()) {
         std::string msg = "Undefined field type '" + type + "' in class " + specific_class.name;
         throw Validator_Exception(msg.c_str());
@@ -120,7 +123,7 @@ void Validator::ensure_user_defined_types(const std::vector<ClassNode>& classes)
     for (const auto& method : specific_class.methods) {
       if(method.return_type.has_value()){
         const std::string& return_type = method.return_type.value();
-        if (primitive_types.find(return_type) == primitive_types.end() &&
+        if (!type_table.contains(return_type) &&
             defined_class_names.find(return_type) == defined_class_names.end()) {
           std::string msg = "Undefined return type '" + return_type + "' in method " +
                             method.name + " of class " + specific_class.name;
@@ -130,7 +133,7 @@ void Validator::ensure_user_defined_types(const std::vector<ClassNode>& classes)
 
       for (const auto& param : method.parameters) {
         const std::string& param_type = param.type;
-        if (primitive_types.find(param_type) == primitive_types.end() &&
+        if (!type_table.contains(param_type) &&
             defined_class_names.find(param_type) == defined_class_names.end()) {
           std::string msg = "Undefined parameter type '" + param_type + "' in method " +
                             method.name + " of class " + specific_class.name;
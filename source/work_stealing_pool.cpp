@@ -0,0 +1,115 @@
+#include "work_stealing_pool.hpp"
+#include "trace.hpp"
+
+WorkStealingPool::WorkStealingPool(std::size_t worker_count) {
+  if (worker_count == 0) {
+    worker_count = 1;
+  }
+  for (std::size_t i = 0; i < worker_count; i++) {
+    queues.push_back(std::make_unique<WorkerQueue>());
+  }
+  workers.reserve(worker_count);
+  for (std::size_t i = 0; i < worker_count; i++) {
+    workers.emplace_back(&WorkStealingPool::worker_loop, this, i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    stopping = true;
+  }
+  batch_started.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+void WorkStealingPool::run(std::vector<std::function<void()>> tasks) {
+  if (tasks.empty()) {
+    return;
+  }
+  {
+    // Counted before any task becomes visible to the workers
+    std::lock_guard<std::mutex> lock(state_mutex);
+    pending = tasks.size();
+    first_error = nullptr;
+  }
+  for (std::size_t i = 0; i < tasks.size(); i++) {
+    WorkerQueue &queue = *queues[i % queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(tasks[i]));
+  }
+
+  std::unique_lock<std::mutex> lock(state_mutex);
+  batch++;
+  batch_started.notify_all();
+  batch_finished.wait(lock, [this]() { return pending == 0; });
+  if (first_error) {
+    std::rethrow_exception(first_error);
+  }
+}
+
+std::size_t WorkStealingPool::size() const { return workers.size(); }
+
+std::size_t WorkStealingPool::steal_count() const { return steals.load(); }
+
+void WorkStealingPool::worker_loop(std::size_t index) {
+  Trace::name_thread("batch worker " + std::to_string(index));
+  std::size_t seen_batch = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(state_mutex);
+      batch_started.wait(
+          lock, [&]() { return stopping || batch != seen_batch; });
+      if (stopping) {
+        return;
+      }
+      seen_batch = batch;
+    }
+
+    std::function<void()> task;
+    while (next_task(index, task)) {
+      std::exception_ptr error;
+      try {
+        task();
+      } catch (...) {
+        error = std::current_exception();
+      }
+      task = nullptr;
+
+      std::lock_guard<std::mutex> lock(state_mutex);
+      if (error && !first_error) {
+        first_error = error;
+      }
+      if (--pending == 0) {
+        batch_finished.notify_all();
+      }
+    }
+  }
+}
+
+// Own queue from the front first, then the back of the other queues
+bool WorkStealingPool::next_task(std::size_t index,
+                                 std::function<void()> &task) {
+  {
+    WorkerQueue &own = *queues[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.front());
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+  for (std::size_t offset = 1; offset < queues.size(); offset++) {
+    WorkerQueue &victim = *queues[(index + offset) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.back());
+      victim.tasks.pop_back();
+      steals++;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,58 @@
+#ifndef WORK_STEALING_POOL
+#define WORK_STEALING_POOL
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool for batches of independent tasks of very different cost. Each worker
+// owns a queue; tasks are dealt to the queues round-robin in the order given
+// (callers put the most expensive first), every worker runs its own queue
+// from the front and, once it is empty, steals from the back of the others.
+class WorkStealingPool {
+public:
+  explicit WorkStealingPool(std::size_t worker_count);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  // Runs every task and returns once all of them finished. Rethrows the
+  // first exception escaping a task (the other tasks still run). Batches
+  // must not be run from several threads at once.
+  void run(std::vector<std::function<void()>> tasks);
+
+  std::size_t size() const;
+  // Tasks run by a worker other than the one they were dealt to
+  std::size_t steal_count() const;
+
+private:
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues;
+  std::vector<std::thread> workers;
+
+  std::mutex state_mutex;
+  std::condition_variable batch_started;
+  std::condition_variable batch_finished;
+  std::size_t batch = 0;   // Incremented for every run()
+  std::size_t pending = 0; // Tasks of the current batch not finished yet
+  bool stopping = false;
+  std::exception_ptr first_error;
+  std::atomic<std::size_t> steals{0};
+
+  void worker_loop(std::size_t index);
+  bool next_task(std::size_t index, std::function<void()> &task);
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../source/batch_converter.hpp"
+#include "../source/custom_exceptions.hpp"
+#include "../source/options.hpp"
+#include "../source/work_stealing_pool.hpp"
+#include "test_utils.hpp"
+
+namespace fs = std::filesystem;
+
+// Every task runs exactly once per batch, failures surface after the whole
+// batch finished, and the pool can run further batches
+TEST(WorkStealingPoolTest, RunsEveryTaskOfEachBatch) {
+  WorkStealingPool pool(4);
+  EXPECT_EQ(pool.size(), 4u);
+
+  for (int batch = 0; batch < 3; batch++) {
+    std::vector<std::atomic<int>> runs(100);
+    std::vector<std::function<void()>> tasks;
+    for (std::size_t i = 0; i < runs.size(); i++) {
+      tasks.push_back([&runs, i]() {
+        // Uneven costs leave some workers idle early, so they steal
+        if (i % 4 == 0) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        runs[i]++;
+      });
+    }
+    pool.run(std::move(tasks));
+    for (const std::atomic<int> &count : runs) {
+      EXPECT_EQ(count.load(), 1);
+    }
+  }
+  EXPECT_GT(pool.steal_count(), 0u);
+
+  std::atomic<int> finished{0};
+  std::vector<std::function<void()>> failing;
+  failing.push_back([]() { throw IO_Exception("first task failed"); });
+  for (int i = 0; i < 10; i++) {
+    failing.push_back([&finished]() { finished++; });
+  }
+  EXPECT_THROW(pool.run(std::move(failing)), IO_Exception);
+  EXPECT_EQ(finished.load(), 10);
+}
+
+// Directory trees map to matching output directories and a broken file
+// is reported without stopping the others
+TEST(BatchConverterTest, IsolatesFailingFiles) {
+  fs::path root = fs::path(TEST_BINARY_DIR) / "batch_test";
+  fs::remove_all(root);
+  fs::create_directories(root / "inputs" / "nested");
+  std::ofstream(root / "inputs" / "Good.cs")
+      << "class Good { private int value; }";
+  std::ofstream(root / "inputs" / "Broken.cs") << "class Broken { private";
+  std::ofstream(root / "inputs" / "nested" / "Inner.cs")
+      << "class Inner { public string name; }";
+  std::ofstream(root / "inputs" / "notes.txt") << "not C#";
+
+  BatchPlan plan = BatchConverter::plan(
+      {(root / "inputs").string(), (root / "missing.cs").string()},
+      (root / "output").string());
+  ASSERT_EQ(plan.inputs.size(), 3u);
+  EXPECT_EQ(plan.inputs[2].output_directory,
+            (root / "output" / "nested" / "Inner").string());
+  ASSERT_EQ(plan.failures.size(), 1u);
+  EXPECT_EQ(plan.failures[0].path, (root / "missing.cs").string());
+
+  WorkStealingPool pool(2);
+  ProgramOptions options;
+  BatchResult result = BatchConverter::convert_all(plan, options, pool);
+  EXPECT_EQ(result.converted_files, 2u);
+  EXPECT_EQ(result.classes, 2u);
+  EXPECT_EQ(result.files_written, 4u);
+  ASSERT_EQ(result.failures.size(), 2u);
+  EXPECT_EQ(result.failures[0].path,
+            (root / "inputs" / "Broken.cs").string());
+  EXPECT_FALSE(result.failures[0].message.empty());
+
+  EXPECT_EQ(directory_entries(root / "output" / "Good"),
+            (std::vector<std::string>{"Good.cpp", "Good.hpp",
+                                      MANIFEST_FILE_NAME}));
+  EXPECT_EQ(directory_entries(root / "output" / "nested" / "Inner"),
+            (std::vector<std::string>{"Inner.cpp", "Inner.hpp",
+                                      MANIFEST_FILE_NAME}));
+  ASSERT_EQ(result.outputs.size(), 2u);
+  EXPECT_EQ(result.outputs[1].manifest.inputs,
+            std::vector<std::string>{
+                (root / "inputs" / "nested" / "Inner.cs").string()});
+
+  // A second run finds everything up to date
+  result = BatchConverter::convert_all(plan, options, pool);
+  EXPECT_EQ(result.files_written, 0u);
+  EXPECT_EQ(result.files_unchanged, 4u);
+}
@@ -0,0 +1,521 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../source/code_generator.hpp"
+#include "../source/custom_exceptions.hpp"
+#include "../source/field_layout.hpp"
+#include "../source/lexer.hpp"
+#include "../source/name_transformer.hpp"
+#include "../source/parser.hpp"
+#include "../source/thread_pool.hpp"
+#include "../source/type_table.hpp"
+#include "../source/unity_builder.hpp"
+#include "../source/validator.hpp"
+
+namespace fs = std::filesystem;
+
+// Access blocks are always printed private -> protected -> public, whatever
+// the declaration order, and members keep their declaration order
+TEST(CodeGenerationOrderTest, AccessBlocksFollowFixedOrder) {
+  std::istringstream input(R"(
+    class A {
+      public int First;
+      protected int Second;
+      private int Third;
+      public int Fourth;
+      protected int Fifth;
+    }
+  )");
+  Lexer lexer(&input);
+  Parser parser(lexer);
+  std::vector<ClassNode> class_nodes = parser.parseProgram();
+  ASSERT_EQ(class_nodes.size(), 1u);
+
+  std::ostringstream first_pass, second_pass;
+  CodeGenerator::generate_class_declaration(class_nodes[0], first_pass);
+  CodeGenerator::generate_class_declaration(class_nodes[0], second_pass);
+
+  EXPECT_EQ(first_pass.str(), "class A {\n"
+                              "private:\n"
+                              "    int third;\n"
+                              "protected:\n"
+                              "    int second;\n"
+                              "    int fifth;\n"
+                              "public:\n"
+                              "    A();\n"
+                              "    int first;\n"
+                              "    int fourth;\n"
+                              "    ~A();\n"
+                              "};\n");
+  EXPECT_EQ(first_pass.str(), second_pass.str());
+}
+
+// Base classes and by-value field types are declared before their users
+TEST(UnityBuildTest, DependenciesComeFirst) {
+  std::istringstream input(R"(
+    class Derived : Middle { private Member m; }
+    class Middle : Root { }
+    class Member { }
+    class Root { }
+  )");
+  Lexer lexer(&input);
+  Parser parser(lexer);
+  std::vector<ClassNode> class_nodes = parser.parseProgram();
+
+  std::vector<std::size_t> order = UnityBuilder::dependency_order(class_nodes);
+  std::vector<std::string> names;
+  for (std::size_t index : order) {
+    names.push_back(class_nodes[index].name);
+  }
+  EXPECT_EQ(names, (std::vector<std::string>{"Root", "Middle", "Member",
+                                             "Derived"}));
+
+  ThreadPool pool(2);
+  UnityOutput output =
+      UnityBuilder::build(class_nodes, 8, GeneratorOptions{}, pool);
+  EXPECT_EQ(output.units.size(), class_nodes.size());
+  EXPECT_LT(output.header.find("class Root {"),
+            output.header.find("class Middle : public Root {"));
+}
+
+TEST(UnityBuildTest, BalancesUnitsBySize) {
+  std::vector<std::vector<std::size_t>> groups =
+      UnityBuilder::balance_by_size({70, 10, 40, 30, 20, 30}, 2);
+  ASSERT_EQ(groups.size(), 2u);
+
+  std::size_t totals[2] = {0, 0};
+  std::vector<std::size_t> sizes = {70, 10, 40, 30, 20, 30};
+  for (int g = 0; g < 2; g++) {
+    EXPECT_TRUE(std::is_sorted(groups[g].begin(), groups[g].end()));
+    for (std::size_t index : groups[g]) {
+      totals[g] += sizes[index];
+    }
+  }
+  EXPECT_EQ(totals[0] + totals[1], 200u);
+  EXPECT_EQ(totals[0], 100u);
+  EXPECT_EQ(totals[1], 100u);
+}
+
+// Complete types are included, types only named in signatures are forward
+// declared in the header and included by the source
+TEST(HeaderIncludesTest, IncludesOnlyWhatNeedsCompleteTypes) {
+  std::istringstream input(R"(
+    class Base { }
+    class Held { }
+    class Returned { }
+    class Passed { }
+    class A : Base {
+      private Held held;
+      public Returned Make(Passed p, string s);
+      public bool Equals(A other);
+    }
+  )");
+  Lexer lexer(&input);
+  Parser parser(lexer);
+  std::vector<ClassNode> class_nodes = parser.parseProgram();
+  const ClassNode &a = class_nodes.back();
+
+  std::ostringstream header, source;
+  CodeGenerator::generate_header(a, header);
+  CodeGenerator::generate_source(a, source);
+
+  EXPECT_EQ(header.str().substr(0, header.str().find("class A ")),
+            "#pragma once\n"
+            "#include <string>\n"
+            "#include \"Base.hpp\"\n"
+            "#include \"Held.hpp\"\n"
+            "\n"
+            "class Passed;\n"
+            "class Returned;\n"
+            "\n");
+  EXPECT_EQ(source.str().substr(0, source.str().find("A::A()")),
+            "#include \"A.hpp\"\n"
+            "#include \"Passed.hpp\"\n"
+            "#include \"Returned.hpp\"\n");
+}
+
+// The performance policy passes non-trivial types by const reference and
+// defaults the copy and move operations
+TEST(EmissionPolicyTest, PerformancePolicySignatures) {
+  std::istringstream input(R"(
+    class Other { }
+    class A {
+      public Other Item {get; set;}
+      public int Count {get{}; }
+      public bool Run(string name, int times, Other other);
+      public bool Equals(A other);
+    }
+  )");
+  Lexer lexer(&input);
+  Parser parser(lexer);
+  std::vector<ClassNode> class_nodes = parser.parseProgram();
+  GeneratorOptions options;
+  options.signature_policy = SignaturePolicy::Performance;
+
+  std::ostringstream header, source;
+  CodeGenerator::generate_class_declaration(class_nodes[1], header, options);
+  CodeGenerator::generate_source_body(class_nodes[1], source, options);
+
+  EXPECT_EQ(header.str(),
+            "class A {\n"
+            "private:\n"
+            "    Other item;\n"
+            "    int count;\n"
+            "public:\n"
+            "    A();\n"
+            "    A(const A& other) = default;\n"
+            "    A(A&& other) = default;\n"
+            "    A& operator=(const A& other) = default;\n"
+            "    A& operator=(A&& other) = default;\n"
+            "    const Other& get_item() const noexcept { return item; }\n"
+            "    void set_item(Other value) { item = std::move(value); }\n"
+            "    int get_count() const;\n"
+            "    bool run(const std::string& name, int times, const Other& "
+            "other);\n"
+            "    bool operator==(const A& other) const;\n"
+            "    ~A();\n"
+            "};\n");
+  // Only the getter with a body keeps an out-of-line definition
+  EXPECT_EQ(source.str().find("get_item"), std::string::npos);
+  EXPECT_EQ(source.str().find("set_item"), std::string::npos);
+  EXPECT_NE(source.str().find("int A::get_count() const {"),
+            std::string::npos);
+  EXPECT_NE(source.str().find("bool A::operator==(const A& other) const {"),
+            std::string::npos);
+}
+
+// Packing orders data members inside each block by alignment and size,
+// leaving all other declarations in place
+TEST(FieldLayoutTest, PacksFieldsWithinAccessBlocks) {
+  std::istringstream input(R"(
+    class Point {
+      public bool Valid;
+      public double X;
+      public bool Dirty;
+      public double Y;
+      private bool Flag {get; set;}
+      private int Count;
+    }
+  )");
+  Lexer lexer(&input);
+  Parser parser(lexer);
+  std::vector<ClassNode> class_nodes = parser.parseProgram();
+
+  ClassLayouts layouts = FieldLayout::compute_class_layouts(class_nodes, true);
+  GeneratorOptions options;
+  options.pack_fields = true;
+  options.class_layouts = &layouts;
+
+  std::ostringstream header;
+  CodeGenerator::generate_class_declaration(class_nodes[0], header, options);
+  EXPECT_EQ(header.str(), "class Point {\n"
+                          "private:\n"
+                          "    int count;\n"
+                          "    bool flag;\n"
+                          "    bool get_flag() { return flag; }\n"
+                          "    void set_flag(bool value) { flag = value; }\n"
+                          "public:\n"
+                          "    Point();\n"
+                          "    bool valid;\n"
+                          "    bool dirty;\n"
+                          "    double x;\n"
+                          "    double y;\n"
+                          "    ~Point();\n"
+                          "};\n");
+
+  std::vector<LayoutReport> reports = FieldLayout::report(class_nodes);
+  ASSERT_EQ(reports.size(), 1u);
+  struct Declared {
+    int count;
+    bool flag;
+    bool valid;
+    double x;
+    bool dirty;
+    double y;
+  };
+  // The public block starts after the bools, which its own bools fill
+  struct Packed {
+    int count;
+    bool flag;
+    bool valid;
+    bool dirty;
+    double x;
+    double y;
+  };
+  EXPECT_EQ(reports[0].declared_size, sizeof(Declared));
+  EXPECT_EQ(reports[0].packed_size, sizeof(Packed));
+}
+
+// Sorting a block by decreasing alignment alone would make this class larger
+TEST(FieldLayoutTest, KeepsDeclaredOrderUnlessSmaller) {
+  std::istringstream input(R"(
+    class P {
+      private bool B;
+      protected double Y;
+      protected bool X;
+    }
+  )");
+  Lexer lexer(&input);
+  Parser parser(lexer);
+  std::vector<ClassNode> class_nodes = parser.parseProgram();
+
+  struct Declared {
+    bool b;
+    double y;
+    bool x;
+  };
+  struct Packed {
+    bool b;
+    bool x;
+    double y;
+  };
+  std::vector<LayoutReport> reports = FieldLayout::report(class_nodes);
+  ASSERT_EQ(reports.size(), 1u);
+  EXPECT_EQ(reports[0].declared_size, sizeof(Declared));
+  EXPECT_EQ(reports[0].packed_size, sizeof(Packed));
+
+  std::istringstream unchanged_input(R"(
+    class P {
+      private bool B;
+      protected bool X;
+      protected double Y;
+    }
+  )");
+  Lexer unchanged_lexer(&unchanged_input);
+  Parser unchanged_parser(unchanged_lexer);
+  class_nodes = unchanged_parser.parseProgram();
+  ClassLayouts layouts = FieldLayout::compute_class_layouts(class_nodes, true);
+  GeneratorOptions options;
+  options.pack_fields = true;
+  options.class_layouts = &layouts;
+  std::ostringstream packed, declared;
+  CodeGenerator::generate_class_declaration(class_nodes[0], packed, options);
+  CodeGenerator::generate_class_declaration(class_nodes[0], declared);
+  EXPECT_EQ(packed.str(), declared.str());
+  reports = FieldLayout::report(class_nodes);
+  EXPECT_EQ(reports[0].packed_size, reports[0].declared_size);
+}
+
+// operator== and hash_value walk the same members, base class first
+TEST(HashSupportTest, EqualityAndHashCoverSameMembers) {
+  std::istringstream input(R"(
+    class Base { }
+    class A : Base {
+      private int Count;
+      public string Name {get; set;}
+    }
+  )");
+  Lexer lexer(&input);
+  Parser parser(lexer);
+  std::vector<ClassNode> class_nodes = parser.parseProgram();
+  GeneratorOptions options;
+  options.hash_support = true;
+
+  std::ostringstream header, source;
+  CodeGenerator::generate_header(class_nodes[1], header, options);
+  CodeGenerator::generate_source_body(class_nodes[1], source, options);
+
+  EXPECT_NE(header.str().find("#include <functional>\n"), std::string::npos);
+  EXPECT_NE(header.str().find("    bool operator==(const A& other) const;\n"
+                              "    std::size_t hash_value() const noexcept;\n"),
+            std::string::npos);
+  EXPECT_NE(header.str().find("template <> struct hash<A> {"),
+            std::string::npos);
+
+  EXPECT_NE(source.str().find("bool A::operator==(const A& other) const {\n"
+                              "    return Base::operator==(other) &&\n"
+                              "           count == other.count &&\n"
+                              "           name == other.name;\n"
+                              "}\n"),
+            std::string::npos);
+  std::string hash_value = source.str().substr(source.str().find(
+      "std::size_t A::hash_value() const noexcept {\n"
+      "    std::size_t seed = Base::hash_value();\n"));
+  EXPECT_LT(hash_value.find("std::hash<int>{}(count)"),
+            hash_value.find("std::hash<std::string>{}(name)"));
+
+  std::ostringstream check;
+  CodeGenerator::generate_hash_check(class_nodes, {"Base.hpp", "A.hpp"},
+                                     check);
+  EXPECT_NE(check.str().find("check_hash_equality<A>(\"A\")"),
+            std::string::npos);
+}
+
+// Byte-at-a-time reference for the table-driven PascalCase -> snake_case
+static std::string reference_snake_case(const std::string &name) {
+  std::string out;
+  for (size_t i = 0; i < name.size(); ++i) {
+    char ch = name[i];
+    if (ch >= 'A' && ch <= 'Z') {
+      if (i != 0)
+        out += '_';
+      out += static_cast<char>(ch - 'A' + 'a');
+    } else {
+      out += ch;
+    }
+  }
+  return out;
+}
+
+TEST(NameTransformerTest, MatchesReferenceConversion) {
+  EXPECT_EQ(NameTransformer::to_snake_case("IntField"), "int_field");
+  EXPECT_EQ(NameTransformer::to_snake_case("do_work"), "do_work");
+  EXPECT_EQ(NameTransformer::to_snake_case("averyLongLowercaseNameX"),
+            "avery_long_lowercase_name_x");
+  EXPECT_EQ(NameTransformer::to_pascal_case("int_field"), "IntField");
+  EXPECT_EQ(NameTransformer::to_pascal_case("_leading__double_"),
+            "LeadingDouble");
+
+  // Every byte value around the 8-byte fast path boundaries
+  const std::string alphabet = "aZ_9@[`{\x80\xC1\xDA\xFF";
+  std::string name = "prefixxx";
+  for (int length = 0; length < 40; length++) {
+    for (char c : alphabet) {
+      std::string candidate = name.substr(0, length % 9) + c + name;
+      std::string out;
+      NameTransformer::append_snake_case(candidate, out);
+      EXPECT_EQ(out, reference_snake_case(candidate)) << candidate;
+    }
+    name += alphabet[length % alphabet.size()];
+  }
+}
+
+TEST(NameTransformerTest, MemoizesEachIdentifier) {
+  const std::string &first = NameTransformer::to_snake_case("CachedName");
+  std::size_t cached = NameTransformer::cached_name_count();
+  const std::string &second = NameTransformer::to_snake_case("CachedName");
+  EXPECT_EQ(&first, &second);
+  EXPECT_EQ(NameTransformer::cached_name_count(), cached);
+}
+
+// Caches are kept until one outgrows its capacity, then started afresh
+TEST(NameTransformerTest, TrimsCachesOverCapacity) {
+  NameTransformer::to_pascal_case("kept_name");
+  NameTransformer::trim_caches();
+  EXPECT_GT(NameTransformer::cached_name_count(), 0u);
+
+  for (std::size_t i = 0; i <= NAME_CACHE_CAPACITY; i++) {
+    NameTransformer::to_snake_case("Name" + std::to_string(i));
+  }
+  EXPECT_GT(NameTransformer::cached_name_count(), NAME_CACHE_CAPACITY);
+  NameTransformer::trim_caches();
+  EXPECT_LE(NameTransformer::cached_name_count(), NAME_CACHE_CAPACITY);
+  EXPECT_EQ(NameTransformer::to_snake_case("Name1"), "name1");
+}
+
+TEST(TypeTableTest, ParsesMappingFile) {
+  std::istringstream mappings(R"(# C# type   C++ type      header
+long        std::int64_t  <cstdint>
+Money       acme::Money   "acme/money.hpp"  by-reference
+
+string      acme::String  "acme/string.hpp" # replaces the built-in mapping
+)");
+  TypeTable table = TypeTable::parse(mappings, "mappings");
+
+  ASSERT_NE(table.find("long"), nullptr);
+  EXPECT_EQ(table.find("long")->cpp_type, "std::int64_t");
+  EXPECT_EQ(table.find("long")->header, "<cstdint>");
+  EXPECT_FALSE(table.find("long")->passed_by_reference);
+  EXPECT_TRUE(table.find("Money")->passed_by_reference);
+  EXPECT_EQ(table.find("string")->cpp_type, "acme::String");
+  EXPECT_TRUE(table.contains("int"));
+  EXPECT_FALSE(table.contains("Unmapped"));
+  EXPECT_EQ(table.size(), TypeTable().size() + 2);
+
+  EXPECT_EQ(table.find("long")->size, sizeof(std::int64_t));
+  EXPECT_EQ(table.find("Money")->size, 0u);
+
+  std::istringstream malformed("Money acme::Money by-pointer\n");
+  EXPECT_THROW(TypeTable::parse(malformed, "mappings"), IO_Exception);
+  std::istringstream unaligned("Money acme::Money size=16\n");
+  EXPECT_THROW(TypeTable::parse(unaligned, "mappings"), IO_Exception);
+  EXPECT_THROW(TypeTable::load("missing_mappings.txt"), IO_Exception);
+}
+
+TEST(TypeTableTest, LookupSurvivesGrowth) {
+  TypeTable table;
+  for (int i = 0; i < 5000; i++) {
+    table.add("Type" + std::to_string(i),
+              TypeMapping{"ns::T" + std::to_string(i), "", false, 0, 0});
+  }
+  for (int i = 0; i < 5000; i++) {
+    const TypeMapping *mapping = table.find("Type" + std::to_string(i));
+    ASSERT_NE(mapping, nullptr);
+    EXPECT_EQ(mapping->cpp_type, "ns::T" + std::to_string(i));
+  }
+  EXPECT_FALSE(table.contains("Type5000"));
+}
+
+// Mapped types are spelled, included and passed as the table says, and are
+// never forward declared as generated classes
+TEST(TypeTableTest, GeneratorUsesActiveMappings) {
+  std::istringstream mappings(R"(
+long   std::int64_t  <cstdint>
+Money  acme::Money   "acme/money.hpp"  by-reference
+)");
+  TypeTable::install(TypeTable::parse(mappings, "mappings"));
+
+  std::istringstream input(R"(
+    class Account {
+      private long id;
+      public Money Deposit(Money amount, long times);
+    }
+  )");
+  Lexer lexer(&input);
+  Parser parser(lexer);
+  std::vector<ClassNode> class_nodes = parser.parseProgram();
+  EXPECT_NO_THROW(Validator::ensure_valid_structure(class_nodes));
+
+  GeneratorOptions options;
+  options.signature_policy = SignaturePolicy::Performance;
+  std::ostringstream header;
+  CodeGenerator::generate_header(class_nodes[0], header, options);
+  TypeTable::install(TypeTable());
+
+  EXPECT_EQ(header.str().substr(0, header.str().find("class Account ")),
+            "#pragma once\n"
+            "#include \"acme/money.hpp\"\n"
+            "#include <cstdint>\n"
+            "\n");
+  EXPECT_NE(header.str().find("std::int64_t id;"), std::string::npos);
+  EXPECT_NE(header.str().find(
+                "acme::Money deposit(const acme::Money& amount, "
+                "std::int64_t times);"),
+            std::string::npos);
+}
+
+// Packing lays out mapped types with the size the table gives them
+TEST(TypeTableTest, FieldLayoutUsesMappedSizes) {
+  std::istringstream mappings(R"(
+short  std::int16_t  <cstdint>
+int    std::int64_t  <cstdint>
+Money  acme::Money   "acme/money.hpp"  size=24 align=4
+)");
+  TypeTable::install(TypeTable::parse(mappings, "mappings"));
+  EXPECT_EQ(FieldLayout::type_layout("short", nullptr).size, 2u);
+  EXPECT_EQ(FieldLayout::type_layout("int", nullptr).size, 8u);
+  EXPECT_EQ(FieldLayout::type_layout("Money", nullptr).alignment, 4u);
+
+  std::istringstream input(R"(
+    class Sample {
+      private short A;
+      private int B;
+      private short C;
+      private Money D;
+    }
+  )");
+  Lexer lexer(&input);
+  Parser parser(lexer);
+  std::vector<LayoutReport> reports =
+      FieldLayout::report(parser.parseProgram());
+  TypeTable::install(TypeTable());
+
+  ASSERT_EQ(reports.size(), 1u);
+  // short, padding, long, short, padding, Money, tail padding
+  EXPECT_EQ(reports[0].declared_size, 2u + 6 + 8 + 2 + 2 + 24 + 4);
+  // long, Money, both shorts, tail padding
+  EXPECT_EQ(reports[0].packed_size, 8u + 24 + 2 + 2 + 4);
+}
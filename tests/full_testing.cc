@@ -3,25 +3,26 @@
 #include <gtest/gtest.h>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "../source/code_generator.hpp"
+#include "../source/converter.hpp"
 #include "../source/custom_exceptions.hpp"
 #include "../source/file_handler.hpp"
+#include "../source/generation_stage.hpp"
 #include "../source/lexer.hpp"
+#include "../source/options.hpp"
+#include "../source/output_directory.hpp"
 #include "../source/parser.hpp"
+#include "../source/run_stats.hpp"
+#include "../source/thread_pool.hpp"
+#include "../source/trace.hpp"
 #include "../source/validator.hpp"
+#include "test_utils.hpp"
 
 namespace fs = std::filesystem;
 
-// Helper function: read whole file to string
-std::string read_file(const fs::path &path) {
-  std::ifstream file(path);
-  std::stringstream ss;
-  ss << file.rdbuf();
-  return ss.str();
-}
-
 // Runs full pipeline on one input and compares generated output to expected
 // output
 void run_test_case(const std::string &test_num) {
@@ -101,3 +102,167 @@ INSTANTIATE_TEST_SUITE_P(RunAllTests, FullPipelineTest,
                                            "8", "9", "10", "11", "12", "13",
                                            "14", "15", "16", "17", "18", "19",
                                            "20", "21", "22", "23", "24", "25"));
+
+// Parallel generation writes the same files as the expected outputs, and
+// results come back in class declaration order
+TEST(ParallelGenerationTest, MatchesExpectedOutputsInOrder) {
+  fs::path input_path = fs::path(TEST_BINARY_DIR) / "tests/inputs/25.cs";
+  fs::path expected_dir = fs::path(TEST_BINARY_DIR) / "tests/outputs/25";
+  fs::path output_dir = fs::path(TEST_BINARY_DIR) / "parallel_output";
+  fs::remove_all(output_dir);
+
+  std::ifstream input_stream =
+      FileHandler::create_input_stream(input_path.string());
+  Lexer lexer(&input_stream);
+  Parser parser(lexer);
+  std::vector<ClassNode> class_nodes = parser.parseProgram();
+  Validator::ensure_valid_structure(class_nodes);
+
+  ThreadPool pool(4);
+  OutputDirectory output(output_dir.string());
+  std::vector<std::future<GeneratedFiles>> pending =
+      GenerationStage::generate_all(class_nodes, output, GeneratorOptions{},
+                                    pool);
+  ASSERT_EQ(pending.size(), class_nodes.size());
+
+  for (std::size_t i = 0; i < pending.size(); i++) {
+    GeneratedFiles files = pending[i].get();
+    const std::string &name = class_nodes[i].name;
+    EXPECT_EQ(fs::path(files.header_path).filename(), name + ".hpp");
+    EXPECT_EQ(read_file(files.header_path),
+              read_file(expected_dir / (name + ".hpp")));
+    EXPECT_EQ(read_file(files.source_path),
+              read_file(expected_dir / (name + ".cpp")));
+  }
+}
+
+// The AST dump is opt-in; per-class output is the default
+TEST(VerbosityTest, ParsesLevels) {
+  auto parse = [](std::vector<std::string> arguments) {
+    std::vector<char *> argv{const_cast<char *>("main")};
+    for (std::string &argument : arguments) {
+      argv.push_back(&argument[0]);
+    }
+    return OptionsParser::parse(static_cast<int>(argv.size()), argv.data())
+        .verbosity;
+  };
+  EXPECT_EQ(parse({"a.cs"}), Verbosity::Classes);
+  EXPECT_EQ(parse({"-q", "a.cs"}), Verbosity::Quiet);
+  EXPECT_EQ(parse({"--verbosity=summary", "a.cs"}), Verbosity::Summary);
+  EXPECT_EQ(parse({"--verbosity", "ast", "a.cs"}), Verbosity::Ast);
+  EXPECT_THROW(parse({"--verbosity=loud", "a.cs"}), Options_Exception);
+}
+
+// Constructors have no return type; the dump must not dereference it
+TEST(VerbosityTest, AstDumpPrintsConstructors) {
+  std::istringstream input(
+      "class A { public A(int x) { } public int f() { } }");
+  Lexer lexer(&input);
+  Parser parser(lexer);
+  std::vector<ClassNode> class_nodes = parser.parseProgram();
+  std::ostringstream dump;
+  dump << class_nodes.at(0);
+  EXPECT_NE(dump.str().find("public A(int x) {}"), std::string::npos);
+  EXPECT_NE(dump.str().find("public int f() {}"), std::string::npos);
+}
+
+// Disabled stats hand nothing to the lexer; enabled stats count what it lexed
+TEST(RunStatsTest, RecordsPhasesAndLexerCounters) {
+  RunStats disabled(false);
+  EXPECT_EQ(disabled.lexer_stats(), nullptr);
+
+  RunStats stats(true);
+  std::istringstream input("class A { public int x; public int f() { } }");
+  Lexer lexer(&input);
+  lexer.collect_stats(stats.lexer_stats());
+  Parser parser(lexer);
+  std::vector<ClassNode> class_nodes = parser.parseProgram();
+  stats.end_phase("parse");
+  stats.count_classes(class_nodes);
+  EXPECT_GT(stats.lexer_stats()->tokens, 0u);
+
+  std::ostringstream json;
+  stats.write_json(json);
+  for (const char *key : {"\"phases\"", "\"parse\"", "\"classes\": 1",
+                          "\"members\": 2", "\"peak_rss_bytes\""}) {
+    EXPECT_NE(json.str().find(key), std::string::npos) << key;
+  }
+  EXPECT_GT(RunStats::peak_rss_bytes(), 0u);
+}
+
+// Every thread records into its own buffer; spans of all threads are
+// exported, balanced and named after their subject
+TEST(TraceTest, ExportsSpansOfEveryThread) {
+  Trace::start();
+  {
+    TraceSpan span("convert", "file", "a.cs");
+    std::thread worker([]() {
+      Trace::name_thread("test worker");
+      for (int i = 0; i < 3000; i++) { // Several buffer chunks
+        TraceSpan span("generate", "class", "Foo");
+      }
+    });
+    worker.join();
+  }
+  Trace::stop();
+  {
+    TraceSpan ignored("not recorded");
+  }
+
+  std::ostringstream json;
+  Trace::write_json(json);
+  const std::string trace = json.str();
+  auto count = [&trace](const std::string &text) {
+    std::size_t found = 0;
+    for (std::size_t at = trace.find(text); at != std::string::npos;
+         at = trace.find(text, at + 1)) {
+      found++;
+    }
+    return found;
+  };
+  EXPECT_EQ(count("\"ph\": \"B\""), count("\"ph\": \"E\""));
+  EXPECT_GE(count("{\"name\": \"generate\""), 6000u);
+  EXPECT_GE(count("\"args\": {\"class\": \"Foo\"}"), 3000u);
+  EXPECT_NE(trace.find("\"args\": {\"file\": \"a.cs\"}"), std::string::npos);
+  EXPECT_NE(trace.find("\"args\": {\"name\": \"test worker\"}"),
+            std::string::npos);
+  EXPECT_EQ(trace.find("not recorded"), std::string::npos);
+}
+
+// The library API returns the buffers the command line writes, from source
+// text alone, and leaves the file system alone
+TEST(ConverterTest, ConvertsSourceTextInMemory) {
+  fs::path expected_dir = fs::path(TEST_BINARY_DIR) / "tests/outputs/25";
+  std::string source =
+      read_file(fs::path(TEST_BINARY_DIR) / "tests/inputs/25.cs");
+  std::vector<fs::path> entries_before(
+      fs::directory_iterator(fs::current_path()), fs::directory_iterator());
+
+  ThreadPool pool(4);
+  ConverterOptions options;
+  options.pool = &pool;
+  ConvertedSource converted = Converter::convert(source, options);
+  ASSERT_FALSE(converted.classes.empty());
+  EXPECT_TRUE(converted.hash_check.empty());
+  for (const GeneratedClass &generated : converted.classes) {
+    EXPECT_EQ(generated.header,
+              read_file(expected_dir / (generated.class_name + ".hpp")));
+    EXPECT_EQ(generated.source,
+              read_file(expected_dir / (generated.class_name + ".cpp")));
+  }
+  std::vector<fs::path> entries_after(
+      fs::directory_iterator(fs::current_path()), fs::directory_iterator());
+  EXPECT_EQ(entries_after.size(), entries_before.size());
+
+  options.pool = nullptr;
+  options.generator.hash_support = true;
+  ConvertedSource hashed =
+      Converter::convert("class A { public int x; }", options);
+  ASSERT_EQ(hashed.classes.size(), 1u);
+  EXPECT_EQ(hashed.members, 1u);
+  EXPECT_NE(hashed.hash_check.find("#include \"A.hpp\""), std::string::npos);
+
+  EXPECT_THROW(Converter::convert("class A { int x; int x; }", options),
+               Validator_Exception);
+  EXPECT_THROW(Converter::convert("class {", options), Parser_Exception);
+}
@@ -0,0 +1,536 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../source/bundle.hpp"
+#include "../source/code_generator.hpp"
+#include "../source/custom_exceptions.hpp"
+#include "../source/file_handler.hpp"
+#include "../source/lexer.hpp"
+#include "../source/options.hpp"
+#include "../source/output_directory.hpp"
+#include "../source/output_manifest.hpp"
+#include "../source/parser.hpp"
+#include "../source/result_cache.hpp"
+#include "test_utils.hpp"
+
+namespace fs = std::filesystem;
+
+// Unchanged content is not rewritten, so the file keeps its modification time
+TEST(WriteAvoidanceTest, SkipsFilesWithIdenticalContent) {
+  fs::path output_dir = fs::path(TEST_BINARY_DIR) / "write_avoidance_output";
+  fs::remove_all(output_dir);
+  OutputDirectory output(output_dir.string());
+  std::string file_path = output.file_path("A.hpp");
+
+  EXPECT_TRUE(output.write_if_changed("A.hpp", "class A {};\n"));
+  fs::file_time_type first_write = fs::last_write_time(file_path);
+  fs::last_write_time(file_path, first_write - std::chrono::hours(1));
+  fs::file_time_type backdated = fs::last_write_time(file_path);
+
+  EXPECT_FALSE(output.write_if_changed("A.hpp", "class A {};\n"));
+  EXPECT_EQ(fs::last_write_time(file_path), backdated);
+
+  // Same size, different content
+  EXPECT_TRUE(output.write_if_changed("A.hpp", "class B {};\n"));
+  EXPECT_EQ(read_file(file_path), "class B {};\n");
+  EXPECT_NE(fs::last_write_time(file_path), backdated);
+}
+
+// The directory is created once; files are compared and written relative
+// to its handle with the same write avoidance
+TEST(OutputDirectoryTest, WritesRelativeToOpenDirectory) {
+  fs::path output_dir =
+      fs::path(TEST_BINARY_DIR) / "output_directory_test" / "nested";
+  fs::remove_all(output_dir.parent_path());
+
+  OutputDirectory output(output_dir.string());
+  ASSERT_TRUE(fs::is_directory(output_dir));
+  EXPECT_EQ(output.file_path("A.hpp"), (output_dir / "A.hpp").string());
+
+  EXPECT_TRUE(output.write_if_changed("A.hpp", "class A {};\n"));
+  fs::path file_path = output_dir / "A.hpp";
+  fs::last_write_time(file_path,
+                      fs::last_write_time(file_path) - std::chrono::hours(1));
+  fs::file_time_type backdated = fs::last_write_time(file_path);
+
+  EXPECT_FALSE(output.write_if_changed("A.hpp", "class A {};\n"));
+  EXPECT_EQ(fs::last_write_time(file_path), backdated);
+  EXPECT_TRUE(output.write_if_changed("A.hpp", "class B {};\n"));
+  EXPECT_EQ(read_file(file_path), "class B {};\n");
+  EXPECT_TRUE(output.write_if_changed("A.hpp", "class A : B {};\n"));
+  EXPECT_EQ(read_file(file_path), "class A : B {};\n");
+
+  OutputDirectoryStats stats = output.stats();
+  EXPECT_EQ(stats.files_written, 3u);
+  EXPECT_EQ(stats.files_unchanged, 1u);
+  EXPECT_GT(stats.resolve_nanoseconds, 0u);
+
+  EXPECT_THROW(OutputDirectory((output_dir / "A.hpp").string()),
+               IO_Exception);
+}
+
+// Files only appear under their final name once complete, and batched
+// durability defers that to commit()
+TEST(OutputDirectoryTest, CommitsFilesAtomically) {
+  fs::path output_dir = fs::path(TEST_BINARY_DIR) / "atomic_output_test";
+  fs::remove_all(output_dir);
+
+  for (Durability durability : {Durability::None, Durability::PerFile}) {
+    OutputDirectory output(output_dir.string(), durability);
+    EXPECT_TRUE(output.write_if_changed("A.hpp", "class A {};\n"));
+    EXPECT_EQ(directory_entries(output_dir),
+              std::vector<std::string>{"A.hpp"});
+    output.commit();
+    fs::remove(output_dir / "A.hpp");
+  }
+
+  {
+    OutputDirectory output(output_dir.string(), Durability::Batched);
+    EXPECT_TRUE(output.write_if_changed("A.hpp", "class A {};\n"));
+    EXPECT_TRUE(output.write_if_changed("B.hpp", "class B {};\n"));
+    EXPECT_FALSE(fs::exists(output_dir / "A.hpp"));
+    output.commit();
+    EXPECT_EQ(directory_entries(output_dir),
+              (std::vector<std::string>{"A.hpp", "B.hpp"}));
+    EXPECT_EQ(read_file(output_dir / "B.hpp"), "class B {};\n");
+  }
+
+  {
+    // A run that stops before committing leaves the old files intact
+    OutputDirectory output(output_dir.string(), Durability::Batched);
+    EXPECT_TRUE(output.write_if_changed("A.hpp", "class Changed {};\n"));
+  }
+  EXPECT_EQ(directory_entries(output_dir),
+            (std::vector<std::string>{"A.hpp", "B.hpp"}));
+  EXPECT_EQ(read_file(output_dir / "A.hpp"), "class A {};\n");
+}
+
+// Batched directories committed into a DeferredCommit keep their files
+// under temporary names, still readable, until the run-level commit
+TEST(OutputDirectoryTest, DefersBatchedRenamesToOneCommit) {
+  fs::path root = fs::path(TEST_BINARY_DIR) / "deferred_output_test";
+  fs::remove_all(root);
+
+  DeferredCommit deferred;
+  {
+    OutputDirectory first((root / "A").string(), Durability::Batched);
+    OutputDirectory second((root / "B").string(), Durability::Batched);
+    first.write_if_changed("A.hpp", "class A {};\n");
+    second.write_if_changed("B.hpp", "class B {};\n");
+    first.commit(deferred);
+    second.commit(deferred);
+    EXPECT_FALSE(fs::exists(root / "A" / "A.hpp"));
+    EXPECT_NE(first.content_path("A.hpp"), first.file_path("A.hpp"));
+    EXPECT_EQ(read_file(first.content_path("A.hpp")), "class A {};\n");
+  }
+  deferred.commit();
+  EXPECT_EQ(directory_entries(root / "A"), std::vector<std::string>{"A.hpp"});
+  EXPECT_EQ(directory_entries(root / "B"), std::vector<std::string>{"B.hpp"});
+  EXPECT_EQ(read_file(root / "B" / "B.hpp"), "class B {};\n");
+
+  {
+    // Dropped without a commit, nothing is left behind
+    DeferredCommit abandoned;
+    OutputDirectory output((root / "A").string(), Durability::Batched);
+    output.write_if_changed("A.hpp", "class Changed {};\n");
+    output.commit(abandoned);
+  }
+  EXPECT_EQ(directory_entries(root / "A"), std::vector<std::string>{"A.hpp"});
+  EXPECT_EQ(read_file(root / "A" / "A.hpp"), "class A {};\n");
+}
+
+// Temporaries of a killed run are removed when the directory is opened;
+// those of a running process only once they are old
+TEST(OutputDirectoryTest, RemovesAbandonedTemporaries) {
+  fs::path output_dir = fs::path(TEST_BINARY_DIR) / "abandoned_output_test";
+  fs::remove_all(output_dir);
+  fs::create_directories(output_dir);
+
+  pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    _exit(0);
+  }
+  ASSERT_EQ(waitpid(child, nullptr, 0), child);
+  std::string dead = std::to_string(child);
+  std::string running = std::to_string(getppid());
+  std::string own = std::to_string(getpid());
+  for (const std::string &name :
+       {".A.hpp." + dead + ".0.tmp", ".B.hpp." + running + ".0.tmp",
+        ".C.hpp." + running + ".1.tmp", ".D.hpp." + own + ".0.tmp",
+        std::string(".notes.tmp")}) {
+    std::ofstream(output_dir / name) << "partial";
+  }
+  fs::last_write_time(output_dir / (".C.hpp." + running + ".1.tmp"),
+                      fs::file_time_type::clock::now() - std::chrono::hours(2));
+
+  OutputDirectory output(output_dir.string());
+  EXPECT_EQ(directory_entries(output_dir),
+            (std::vector<std::string>{".B.hpp." + running + ".0.tmp",
+                                      ".D.hpp." + own + ".0.tmp",
+                                      ".notes.tmp"}));
+}
+
+TEST(InputFileTest, MapsRegularFiles) {
+  fs::path input_path = fs::path(TEST_BINARY_DIR) / "tests/inputs/25.cs";
+  InputFile input = FileHandler::read_input_file(input_path.string());
+  EXPECT_TRUE(input.is_mapped());
+
+  std::ifstream input_stream{input_path};
+  std::string expected{std::istreambuf_iterator<char>(input_stream),
+                       std::istreambuf_iterator<char>()};
+  EXPECT_EQ(input.view(), expected);
+
+  InputFile moved = std::move(input);
+  EXPECT_EQ(moved.view(), expected);
+  EXPECT_TRUE(input.view().empty());
+}
+
+TEST(InputFileTest, ReadsPipesIntoBuffer) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  const std::string content = "class Piped { }\n";
+  ASSERT_EQ(write(fds[1], content.data(), content.size()),
+            static_cast<ssize_t>(content.size()));
+  close(fds[1]);
+
+  InputFile input =
+      FileHandler::read_input_file("/dev/fd/" + std::to_string(fds[0]));
+  close(fds[0]);
+  EXPECT_FALSE(input.is_mapped());
+  EXPECT_EQ(input.view(), content);
+}
+
+TEST(InputFileTest, RejectsUnusableFiles) {
+  fs::path dir = fs::path(TEST_BINARY_DIR) / "input_file_test";
+  fs::create_directories(dir);
+  std::ofstream{dir / "empty.cs"};
+  std::ofstream{dir / "small.cs"} << "class Small { }\n";
+
+  EXPECT_THROW(FileHandler::read_input_file((dir / "empty.cs").string()),
+               IO_Exception);
+  EXPECT_THROW(FileHandler::read_input_file((dir / "missing.cs").string()),
+               IO_Exception);
+  EXPECT_THROW(FileHandler::read_input_file(dir.string()), IO_Exception);
+  EXPECT_THROW(FileHandler::read_input_file((dir / "small.cs").string(), 8),
+               IO_Exception);
+  EXPECT_NO_THROW(FileHandler::read_input_file((dir / "small.cs").string()));
+}
+
+// Lexing the mapped view produces the same classes as lexing the stream
+TEST(InputFileTest, LexerConsumesViewInPlace) {
+  fs::path input_path = fs::path(TEST_BINARY_DIR) / "tests/inputs/25.cs";
+  InputFile input = FileHandler::read_input_file(input_path.string());
+  Lexer view_lexer(input.view());
+  Parser view_parser(view_lexer);
+  std::vector<ClassNode> from_view = view_parser.parseProgram();
+
+  std::ifstream input_stream{input_path};
+  Lexer stream_lexer(&input_stream);
+  Parser stream_parser(stream_lexer);
+  std::vector<ClassNode> from_stream = stream_parser.parseProgram();
+
+  ASSERT_EQ(from_view.size(), from_stream.size());
+  for (std::size_t i = 0; i < from_view.size(); i++) {
+    std::ostringstream view_header, stream_header;
+    CodeGenerator::generate_header(from_view[i], view_header);
+    CodeGenerator::generate_header(from_stream[i], stream_header);
+    EXPECT_EQ(view_header.str(), stream_header.str());
+  }
+
+  Lexer unterminated(std::string_view("class A { void F() { "));
+  Parser parser(unterminated);
+  EXPECT_THROW(parser.parseProgram(), Parser_Exception);
+}
+
+TEST(BundleTest, ReaderReturnsWhatWriterAdded) {
+  const std::string long_name =
+      std::string(120, 'd') + "/" + std::string(90, 'f') + ".hpp";
+  const std::vector<std::pair<std::string, std::string>> files = {
+      {"A.hpp", "class A {};\n"},
+      {"Empty.cpp", ""},
+      {"Block.cpp", std::string(BUNDLE_BLOCK_SIZE, 'b')},
+      {long_name, "long"}};
+
+  std::ostringstream output;
+  BundleWriter writer(output);
+  for (const auto &[name, content] : files) {
+    writer.add(name, content);
+  }
+  writer.finish();
+  std::string data = output.str();
+  EXPECT_EQ(writer.entry_count(), files.size());
+  EXPECT_EQ(writer.bytes_written(), data.size());
+  EXPECT_EQ(data.size() % BUNDLE_BLOCK_SIZE, 0u);
+
+  BundleReader reader(data);
+  ASSERT_EQ(reader.entries().size(), files.size());
+  for (std::size_t i = 0; i < files.size(); i++) {
+    EXPECT_EQ(reader.entries()[i].name, files[i].first);
+    EXPECT_EQ(reader.entries()[i].content, files[i].second);
+  }
+  ASSERT_NE(reader.find("Block.cpp"), nullptr);
+  EXPECT_EQ(reader.find("Block.cpp")->content.size(),
+            std::size_t{BUNDLE_BLOCK_SIZE});
+  EXPECT_EQ(reader.find("Missing.hpp"), nullptr);
+
+  EXPECT_THROW(writer.add(std::string(101, 'n'), ""), IO_Exception);
+}
+
+TEST(BundleTest, RejectsCorruptData) {
+  std::ostringstream output;
+  BundleWriter writer(output);
+  writer.add("A.hpp", "class A {};\n");
+  writer.finish();
+  std::string data = output.str();
+
+  EXPECT_THROW(BundleReader(data.substr(0, BUNDLE_BLOCK_SIZE + 10)),
+               IO_Exception);
+  EXPECT_THROW(BundleReader(data.substr(0, 2 * BUNDLE_BLOCK_SIZE)),
+               IO_Exception);
+  std::string corrupt = data;
+  corrupt[0] = 'B';
+  EXPECT_THROW(BundleReader{corrupt}, IO_Exception);
+  EXPECT_THROW(BundleReader{std::string(BUNDLE_BLOCK_SIZE, 'x')},
+               IO_Exception);
+}
+
+// Streaming mode plumbing: a bundle written through the descriptor buffer
+// and read back from standard input
+TEST(StreamingTest, BundleThroughPipeToStandardInput) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  const std::string large(3 * STREAM_BUFFER_SIZE / 2, 'l');
+  // Larger than the pipe capacity, so written while the test reads
+  std::thread writer_thread([&]() {
+    bool good = false;
+    {
+      DescriptorOutputBuffer buffer(fds[1], 4096);
+      std::ostream output(&buffer);
+      BundleWriter writer(output);
+      writer.add("Small.hpp", "class Small {};\n");
+      writer.add("Large.cpp", large);
+      writer.finish();
+      good = output.good();
+    }
+    close(fds[1]);
+    EXPECT_TRUE(good);
+  });
+
+  int saved_stdin = dup(STDIN_FILENO);
+  ASSERT_EQ(dup2(fds[0], STDIN_FILENO), STDIN_FILENO);
+  close(fds[0]);
+  InputFile input = FileHandler::read_standard_input();
+  dup2(saved_stdin, STDIN_FILENO);
+  close(saved_stdin);
+  writer_thread.join();
+
+  BundleReader reader(input.view());
+  ASSERT_EQ(reader.entries().size(), 2u);
+  EXPECT_EQ(reader.find("Small.hpp")->content, "class Small {};\n");
+  EXPECT_EQ(reader.find("Large.cpp")->content, large);
+}
+
+// Exit status of the command line converting input from standard input,
+// with its standard output kept in output
+static int run_converter_on_stdin(const std::string &arguments,
+                                  const std::string &input,
+                                  std::string &output) {
+  fs::path directory = fs::path(TEST_BINARY_DIR) / "converter_run";
+  fs::create_directories(directory);
+  std::ofstream(directory / "input.cs") << input;
+  std::string command = "cd '" + directory.string() + "' && '" CONVERTER_PATH
+                        "' " + arguments + " < input.cs > output 2> errors";
+  int status = std::system(command.c_str());
+  output = read_file(directory / "output");
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// A pipeline sees a failed conversion in the exit status, and no bundle
+TEST(StreamingTest, FailedConversionExitsWithFailure) {
+  std::string output;
+  EXPECT_NE(run_converter_on_stdin("-q -", "class Bad {", output), 0);
+  EXPECT_TRUE(output.empty());
+  EXPECT_NE(run_converter_on_stdin("-q -", "class A { int x; int x; }",
+                                   output),
+            0);
+  EXPECT_TRUE(output.empty());
+
+  EXPECT_EQ(run_converter_on_stdin("-q -", "class A { }", output), 0);
+  EXPECT_EQ(BundleReader(output).entries().size(), 2u);
+}
+
+// Outputs of an earlier run that this one did not produce are removed;
+// files the manifest never listed are not touched
+TEST(OutputManifestTest, RemovesStaleOutputsAndWritesDepfileRules) {
+  fs::path output_dir = fs::path(TEST_BINARY_DIR) / "manifest_test";
+  fs::remove_all(output_dir);
+  {
+    OutputDirectory output(output_dir.string());
+    output.write_if_changed("A.hpp", "class A {};\n");
+    output.write_if_changed("B.hpp", "class B {};\n");
+    ManifestUpdate update = ManifestFile::update(output, {"in.cs"});
+    EXPECT_TRUE(update.stale_files.empty());
+    output.commit();
+  }
+  std::ofstream(output_dir / "notes.txt") << "kept";
+
+  OutputDirectory output(output_dir.string());
+  output.write_if_changed("A.hpp", "class A {};\n");
+  ManifestUpdate update =
+      ManifestFile::update(output, {"./in.cs", "types.map"});
+  output.commit();
+  EXPECT_EQ(update.stale_files, std::vector<std::string>{"B.hpp"});
+  EXPECT_EQ(directory_entries(output_dir),
+            (std::vector<std::string>{"A.hpp", MANIFEST_FILE_NAME,
+                                      "notes.txt"}));
+
+  OutputManifest manifest = ManifestFile::read(output);
+  EXPECT_EQ(manifest.outputs, std::vector<std::string>{"A.hpp"});
+  EXPECT_EQ(manifest.inputs,
+            (std::vector<std::string>{"./in.cs", "types.map"}));
+
+  std::ostringstream rule;
+  ManifestFile::write_depfile_rule(rule, {"out/m", "out/$A.hpp"},
+                                   {"my dir/in.cs", "types.map"});
+  EXPECT_EQ(rule.str(),
+            "out/m \\\n  out/$$A.hpp: \\\n  my\\ dir/in.cs \\\n  types.map\n");
+}
+
+// Converting another input into the same directory keeps the outputs of
+// the first one, as before manifests existed
+TEST(OutputManifestTest, KeepsOutputsOfOtherInputs) {
+  fs::path output_dir = fs::path(TEST_BINARY_DIR) / "manifest_inputs_test";
+  fs::remove_all(output_dir);
+  auto convert = [&](const std::string &input, const std::string &file_name) {
+    OutputDirectory output(output_dir.string());
+    output.write_if_changed(file_name, "// " + input + "\n");
+    ManifestUpdate update = ManifestFile::update(output, {input});
+    output.commit();
+    return update;
+  };
+  convert("first.cs", "A.hpp");
+  EXPECT_TRUE(convert("second.cs", "B.hpp").stale_files.empty());
+  EXPECT_EQ(directory_entries(output_dir),
+            (std::vector<std::string>{"A.hpp", "B.hpp", MANIFEST_FILE_NAME}));
+  EXPECT_EQ(ManifestFile::read(OutputDirectory(output_dir.string())).inputs,
+            std::vector<std::string>{"second.cs"});
+
+  EXPECT_EQ(convert("second.cs", "C.hpp").stale_files,
+            std::vector<std::string>{"B.hpp"});
+  EXPECT_EQ(directory_entries(output_dir),
+            (std::vector<std::string>{"A.hpp", "C.hpp", MANIFEST_FILE_NAME}));
+}
+
+// Hits hard-link verified files; other inputs, other options and damaged
+// entries miss, and the least recently used entry is evicted first
+TEST(ResultCacheTest, RestoresLinksAndEvictsLeastRecentlyUsed) {
+  fs::path root = fs::path(TEST_BINARY_DIR) / "result_cache_test";
+  fs::remove_all(root);
+  ProgramOptions options;
+  ResultCache cache((root / "cache").string(), 1 << 20,
+                    ResultCache::fingerprint(options));
+  options.generator.hash_support = true;
+  EXPECT_NE(cache.key("class A { }"),
+            ResultCache((root / "cache").string(), 1 << 20,
+                        ResultCache::fingerprint(options))
+                .key("class A { }"));
+
+  auto convert = [&](const std::string &source, const std::string &name) {
+    OutputDirectory output((root / name).string());
+    output.write_if_changed("A.hpp", "// " + source + "\n");
+    output.commit();
+    cache.store(cache.key(source), source, output, CachedConversion{1, 0});
+  };
+  convert("class A { }", "first");
+  convert("class A { int x; }", "second");
+
+  CachedConversion restored;
+  {
+    OutputDirectory output((root / "restored").string());
+    EXPECT_TRUE(cache.restore(cache.key("class A { }"), "class A { }", output,
+                              restored));
+    EXPECT_FALSE(cache.restore(cache.key("class B { }"), "class B { }",
+                               output, restored));
+    output.commit();
+  }
+  EXPECT_EQ(restored.classes, 1u);
+  EXPECT_EQ(read_file(root / "restored" / "A.hpp"), "// class A { }\n");
+  EXPECT_TRUE(fs::equivalent(
+      root / "restored" / "A.hpp",
+      root / "cache" / "entries" / cache.key("class A { }") / "files" /
+          "A.hpp"));
+
+  // The restored entry is now the most recently used one; the clock of the
+  // file system may be too coarse to tell it apart from the second store
+  fs::last_write_time(root / "cache" / "entries" /
+                          cache.key("class A { int x; }") / "index",
+                      fs::file_time_type::clock::now() - std::chrono::hours(1));
+  ResultCache small((root / "cache").string(), 45,
+                    ResultCache::fingerprint(ProgramOptions{}));
+  OutputDirectory third((root / "third").string());
+  third.write_if_changed("A.hpp", "// third\n");
+  third.commit();
+  small.store(small.key("third"), "third", third, CachedConversion{});
+  EXPECT_EQ(small.stats().evictions, 1u);
+  EXPECT_TRUE(
+      fs::exists(root / "cache" / "entries" / cache.key("class A { }")));
+  EXPECT_FALSE(
+      fs::exists(root / "cache" / "entries" / cache.key("class A { int x; }")));
+
+  fs::path cached_file = root / "cache" / "entries" /
+                         cache.key("class A { }") / "files" / "A.hpp";
+  fs::permissions(cached_file, fs::perms::owner_write, fs::perm_options::add);
+  std::ofstream(cached_file) << "damaged";
+  OutputDirectory output((root / "restored").string());
+  EXPECT_FALSE(
+      cache.restore(cache.key("class A { }"), "class A { }", output, restored));
+  EXPECT_EQ(cache.stats().hits, 1u);
+  EXPECT_EQ(cache.stats().misses, 2u);
+}
+
+// The size is counted on the first store and then kept by this process, so
+// entries stored by others are only seen once its own stores cross the limit
+TEST(ResultCacheTest, ListsEntriesOnlyWhenCrossingTheLimit) {
+  fs::path root = fs::path(TEST_BINARY_DIR) / "result_cache_size_test";
+  fs::remove_all(root);
+  std::string fingerprint = ResultCache::fingerprint(ProgramOptions{});
+  ResultCache cache((root / "cache").string(), 100, fingerprint);
+  ResultCache other((root / "cache").string(), 1 << 20, fingerprint);
+
+  auto store = [&](ResultCache &into, const std::string &source) {
+    OutputDirectory output((root / source).string());
+    output.write_if_changed("A.hpp", std::string(40, 'x'));
+    output.commit();
+    into.store(into.key(source), source, output, CachedConversion{});
+  };
+  store(cache, "first"); // 45 bytes, counted by listing the entries
+  store(other, "second");
+  store(other, "third");
+  store(other, "fourth"); // 183 bytes in all, 45 as far as cache knows
+  store(cache, "fifth");
+  EXPECT_EQ(cache.stats().evictions, 0u);
+  store(cache, "sixth"); // Over the limit by its own count: lists and evicts
+  EXPECT_GT(cache.stats().evictions, 0u);
+
+  std::uint64_t total = 0;
+  for (const fs::directory_entry &entry :
+       fs::recursive_directory_iterator(root / "cache" / "entries")) {
+    std::string name = entry.path().filename().string();
+    if (entry.is_regular_file() && name != "index") {
+      total += entry.file_size();
+    }
+  }
+  EXPECT_LE(total, 90u);
+}
@@ -1,5 +1,7 @@
+#pragma once
+
 class A {
 public:
     A();
-    ~A();  
-};
\ No newline at end of file
+    ~A();
+};
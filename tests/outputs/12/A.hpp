@@ -1,9 +1,11 @@
+#pragma once
+
 class A {
 private:
     int x;
 public:
     A();
-    int get_x();
-    void set_x(int value);
+    int get_x() { return x; }
+    void set_x(int value) { x = value; }
     ~A();
 };
@@ -2,12 +2,6 @@
 A::A() {
     //TODO: implement this method
 }
-int A::get_x() {
-    //TODO: implement this method
-}
-void A::set_x(int value) {
-    //TODO: implement this method
-}
 A::~A() {
     //TODO: implement this method
 }
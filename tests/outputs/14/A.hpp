@@ -1,8 +1,10 @@
+#pragma once
+
 class A {
 private:
     int x;
-    int get_x();
-    void set_x(int value);
+    int get_x() { return x; }
+    void set_x(int value) { x = value; }
 public:
     A();
     ~A();
@@ -5,4 +5,3 @@ AnotherClass::AnotherClass() {
 AnotherClass::~AnotherClass() {
     //TODO: implement this method
 }
- 
\ No newline at end of file
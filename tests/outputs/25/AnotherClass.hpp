@@ -1,5 +1,7 @@
+#pragma once
+
 class AnotherClass {
 public:
     AnotherClass();
-    ~AnotherClass();    
+    ~AnotherClass();
 };
@@ -4,5 +4,4 @@ Base::Base() {
 }
 Base::~Base() {
     //TODO: implement this method
-} 
- 
\ No newline at end of file
+}
@@ -1,3 +1,5 @@
+#pragma once
+
 class Base {
 public:
     Base();
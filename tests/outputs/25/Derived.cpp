@@ -1,20 +1,12 @@
 #include "Derived.hpp"
+#include "YetAnotherClass.hpp"
 Derived::Derived() {
     //TODO: implement this method
-} 
-int Derived::get_int_field() {
-    //TODO: implement this method
-}
-AnotherClass Derived::get_class_field() {
-    //TODO: implement this method
-}
-void Derived::set_class_field(AnotherClass value) {
-    //TODO: implement this method
 }
 bool Derived::do_work(std::string param1, double param2, YetAnotherClass param3) {
     //TODO: implement this method
 }
-bool operator==(const Derived& other) {
+bool Derived::operator==(const Derived& other) {
     //TODO: implement this method
 }
 Derived::~Derived() {
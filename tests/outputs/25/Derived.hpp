@@ -1,12 +1,19 @@
+#pragma once
+#include <string>
+#include "AnotherClass.hpp"
+#include "Base.hpp"
+
+class YetAnotherClass;
+
 class Derived : public Base {
-  private:
+private:
     int int_field;
     AnotherClass class_field;
-  public:
+public:
     Derived();
-    int get_int_field();
-    AnotherClass get_class_field();
-    void set_class_field(AnotherClass value);
+    int get_int_field() { return int_field; }
+    AnotherClass get_class_field() { return class_field; }
+    void set_class_field(AnotherClass value) { class_field = value; }
     bool do_work(std::string param1, double param2, YetAnotherClass param3);
     bool operator==(const Derived& other);
     ~Derived();
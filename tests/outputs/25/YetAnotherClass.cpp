@@ -5,4 +5,3 @@ YetAnotherClass::YetAnotherClass() {
 YetAnotherClass::~YetAnotherClass() {
     //TODO: implement this method
 }
- 
\ No newline at end of file
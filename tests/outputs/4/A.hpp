@@ -1,3 +1,5 @@
+#pragma once
+
 class A {
 protected:
     int x;
@@ -1,3 +1,6 @@
+#pragma once
+#include <string>
+
 class A {
 private:
     float fnumber;
@@ -1,3 +1,6 @@
+#pragma once
+#include "B.hpp"
+
 class A {
 private:
     B b;
@@ -1,3 +1,5 @@
+#pragma once
+
 class A {
 private:
     void hidden();
@@ -3,8 +3,10 @@
 #include "../source/file_handler.hpp"
 #include "../source/lexer.hpp"
 #include "../source/parser.hpp"
+#include "../source/type_table.hpp"
 #include "../source/validator.hpp"
 #include <gtest/gtest.h>
+#include <sstream>
 
 // Helper functions to construct nodes with necessary fields
 
@@ -152,3 +154,15 @@ TEST(ValidatorTests, EnsureValidStructureNoThrowOnDefinedUserType){
 
   EXPECT_NO_THROW(Validator::ensure_valid_structure(classes));
 }
+
+TEST(ValidatorTests, EnsureValidStructureAcceptsMappedTypes) {
+  ClassNode c = make_class("Account");
+  c.fields.push_back(make_field("balance", "Money"));
+  std::vector<ClassNode> classes = {c};
+  EXPECT_THROW(Validator::ensure_valid_structure(classes), Validator_Exception);
+
+  std::istringstream mappings("Money acme::Money \"acme/money.hpp\"\n");
+  TypeTable::install(TypeTable::parse(mappings, "mappings"));
+  EXPECT_NO_THROW(Validator::ensure_valid_structure(classes));
+  TypeTable::install(TypeTable());
+}
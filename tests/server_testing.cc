@@ -0,0 +1,232 @@
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../source/ast_cache.hpp"
+#include "../source/batch_converter.hpp"
+#include "../source/conversion_server.hpp"
+#include "../source/custom_exceptions.hpp"
+#include "../source/file_watcher.hpp"
+#include "../source/incremental_converter.hpp"
+#include "../source/lexer.hpp"
+#include "../source/options.hpp"
+#include "../source/parser.hpp"
+#include "test_utils.hpp"
+
+namespace fs = std::filesystem;
+
+TEST(AstCacheTest, EvictsLeastRecentlyUsed) {
+  AstCache cache(2);
+  auto nodes = std::make_shared<const std::vector<ClassNode>>();
+  cache.insert("class A { }", "", nodes);
+  cache.insert("class B { }", "", nodes);
+  EXPECT_EQ(cache.find("class A { }", ""), nodes); // B is now the oldest
+  EXPECT_EQ(cache.find("class A { }", "types.map@1"), nullptr);
+  cache.insert("class C { }", "", nodes);
+  EXPECT_EQ(cache.size(), 2u);
+  EXPECT_EQ(cache.find("class B { }", ""), nullptr);
+  EXPECT_EQ(cache.find("class C { }", ""), nodes);
+  EXPECT_EQ(cache.hits(), 2u);
+  EXPECT_EQ(cache.misses(), 2u);
+}
+
+// A stand-in handler parsing through a warm AST cache, driven by the
+// client and by a raw connection sending garbage
+TEST(ConversionServerTest, AnswersRequestsUntilStopped) {
+  std::string socket_path =
+      "/tmp/cs_converter_test_" + std::to_string(getpid()) + ".sock";
+  AstCache cache;
+  ConversionServer server(
+      socket_path, [&cache](const ConversionRequest &request) {
+        AstCache::ClassNodes class_nodes =
+            cache.find(request.standard_input, "");
+        if (!class_nodes) {
+          Lexer lexer(request.standard_input);
+          Parser parser(lexer);
+          class_nodes = std::make_shared<const std::vector<ClassNode>>(
+              parser.parseProgram());
+          cache.insert(request.standard_input, "", class_nodes);
+        }
+        ConversionResponse response;
+        response.standard_output =
+            request.working_directory + " " + request.arguments.at(0) + " " +
+            std::to_string(class_nodes->size());
+        response.exit_status = 3;
+        return response;
+      });
+  std::thread server_thread([&server]() { server.serve(); });
+
+  ConversionRequest request{"/work", {"-", "--stats"},
+                            "class A { } class B { }"};
+  for (int i = 0; i < 2; i++) {
+    ConversionResponse response = ConversionClient::send(socket_path, request);
+    EXPECT_EQ(response.exit_status, 3);
+    EXPECT_EQ(response.standard_output, "/work - 2");
+  }
+  EXPECT_EQ(cache.hits(), 1u);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::strcpy(address.sun_path, socket_path.c_str());
+  ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr *>(&address),
+                    sizeof(address)),
+            0);
+  const char garbage[] = "GET / HTTP/1.1\r\n\r\n";
+  ASSERT_EQ(write(fd, garbage, sizeof(garbage) - 1),
+            static_cast<ssize_t>(sizeof(garbage) - 1));
+  std::string reply(4096, '\0');
+  ssize_t length = read(fd, &reply[0], reply.size());
+  close(fd);
+  ASSERT_GT(length, 0);
+  EXPECT_NE(reply.find("Malformed conversion message"), std::string::npos);
+
+  server.stop();
+  server_thread.join();
+  EXPECT_EQ(server.requests_served(), 3u);
+  EXPECT_THROW(ConversionServer(socket_path, nullptr), IO_Exception);
+}
+
+// A missing socket directory is created private and the socket only ever
+// has owner permissions, whatever the umask
+TEST(ConversionServerTest, KeepsTheSocketPrivate) {
+  fs::path directory =
+      "/tmp/cs_converter_private_" + std::to_string(getpid());
+  fs::remove_all(directory);
+  std::string socket_path = (directory / "server.sock").string();
+
+  mode_t previous_mask = umask(0);
+  {
+    ConversionServer server(socket_path, nullptr);
+    EXPECT_EQ(fs::status(directory).permissions() & fs::perms::all,
+              fs::perms::owner_all);
+    EXPECT_EQ(fs::status(socket_path).permissions() & fs::perms::all,
+              fs::perms::owner_read | fs::perms::owner_write);
+  }
+  umask(previous_mask);
+  fs::remove_all(directory);
+}
+
+// A failed conversion reaches the client as a failure status, and requests
+// from other directories do not move the server's own relative paths
+TEST(ConversionServerTest, ReportsFailuresAndKeepsItsDirectory) {
+  fs::path root = fs::path(TEST_BINARY_DIR) / "server_directory_test";
+  fs::remove_all(root);
+  fs::create_directories(root / "server");
+  fs::create_directories(root / "client");
+  std::string socket_path =
+      "/tmp/cs_converter_e2e_" + std::to_string(getpid()) + ".sock";
+  std::string serve_option = "--serve=" + socket_path;
+
+  pid_t server = fork();
+  ASSERT_GE(server, 0);
+  if (server == 0) {
+    if (chdir((root / "server").c_str()) == 0) {
+      execl(CONVERTER_PATH, CONVERTER_PATH, serve_option.c_str(), "--trace",
+            "trace.json", static_cast<char *>(nullptr));
+    }
+    _exit(127);
+  }
+  for (int i = 0; i < 500 && !fs::exists(socket_path); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  std::string client = (root / "client").string();
+  ConversionResponse failed = ConversionClient::send(
+      socket_path, ConversionRequest{client, {"-q", "-"}, "class Bad {"});
+  EXPECT_NE(failed.exit_status, 0);
+  EXPECT_NE(failed.standard_error.find("Parser_Exception"), std::string::npos);
+  ConversionResponse converted = ConversionClient::send(
+      socket_path, ConversionRequest{client, {"-q", "-"}, "class A { }"});
+  EXPECT_EQ(converted.exit_status, 0);
+
+  kill(server, SIGTERM);
+  int status = 0;
+  ASSERT_EQ(waitpid(server, &status, 0), server);
+  EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  EXPECT_TRUE(fs::exists(root / "server" / "trace.json"));
+  EXPECT_FALSE(fs::exists(root / "client" / "trace.json"));
+}
+
+// Only the classes whose AST changed are rendered again, files of removed
+// classes are deleted and a broken edit keeps the previous output
+TEST(IncrementalConverterTest, RegeneratesChangedClassesOnly) {
+  fs::path root = fs::path(TEST_BINARY_DIR) / "incremental_test";
+  fs::remove_all(root);
+  fs::create_directories(root);
+  fs::path input_path = root / "Shapes.cs";
+  auto save = [&](const std::string &source) {
+    std::ofstream(input_path) << source;
+  };
+
+  IncrementalConverter converter{ProgramOptions{}};
+  save("class A { private int x; } class B { public string name; }");
+  IncrementalUpdate update = converter.add(
+      BatchInput{input_path.string(), (root / "output").string(), 0});
+  EXPECT_TRUE(update.error.empty());
+  EXPECT_EQ(update.classes_generated, 2u);
+  EXPECT_EQ(update.files_written, 4u);
+  EXPECT_TRUE(converter.refresh(input_path.string()).source_unchanged);
+
+  save("class A { private int x; private int y; } "
+       "class B { public string name; }");
+  update = converter.refresh(input_path.string());
+  EXPECT_EQ(update.classes_generated, 1u);
+  EXPECT_EQ(update.classes_unchanged, 1u);
+  EXPECT_NE(read_file(root / "output" / "A.hpp").find("y"), std::string::npos);
+
+  save("class A { private int x; private int y; } class B { public");
+  update = converter.refresh(input_path.string());
+  EXPECT_FALSE(update.error.empty());
+  EXPECT_TRUE(fs::exists(root / "output" / "B.hpp"));
+
+  save("class A { private int x; private int y; }");
+  update = converter.refresh(input_path.string());
+  EXPECT_EQ(update.classes_generated, 0u);
+  EXPECT_EQ(update.classes_removed, 1u);
+  EXPECT_EQ(directory_entries(root / "output"),
+            (std::vector<std::string>{"A.cpp", "A.hpp", MANIFEST_FILE_NAME}));
+}
+
+// Changes come back as one sorted batch once the directory stays quiet
+TEST(FileWatcherTest, DebouncesBurstsOfChanges) {
+  fs::path root = fs::path(TEST_BINARY_DIR) / "watcher_test";
+  fs::remove_all(root);
+  fs::create_directories(root);
+  FileWatcher watcher;
+  watcher.watch_directory(root.string());
+  watcher.watch_directory(root.string() + "/");
+  EXPECT_EQ(watcher.directory_count(), 1u);
+
+  std::thread editor([&root]() {
+    for (int i = 0; i < 5; i++) {
+      std::ofstream(root / "B.cs") << "class B { }";
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    std::ofstream(root / "A.cs.tmp") << "class A { }";
+    fs::rename(root / "A.cs.tmp", root / "A.cs");
+  });
+  std::vector<std::string> changed =
+      watcher.wait_for_changes(std::chrono::milliseconds(200));
+  editor.join();
+  EXPECT_EQ(changed, (std::vector<std::string>{(root / "A.cs").string(),
+                                               (root / "A.cs.tmp").string(),
+                                               (root / "B.cs").string()}));
+
+  watcher.stop();
+  EXPECT_TRUE(watcher.wait_for_changes(std::chrono::milliseconds(1)).empty());
+}
@@ -0,0 +1,33 @@
+#ifndef TEST_UTILS
+#define TEST_UTILS
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Helpers shared by the test binaries
+
+// Helper function: read whole file to string
+inline std::string read_file(const std::filesystem::path &path) {
+  std::ifstream file(path);
+  std::stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+// Names of the entries of a directory, sorted
+inline std::vector<std::string>
+directory_entries(const std::filesystem::path &directory) {
+  std::vector<std::string> entries;
+  for (const std::filesystem::directory_entry &entry :
+       std::filesystem::directory_iterator(directory)) {
+    entries.push_back(entry.path().filename().string());
+  }
+  std::sort(entries.begin(), entries.end());
+  return entries;
+}
+
+#endif
@@ -0,0 +1,66 @@
+// Extracts (or lists) the files of a bundle written with --bundle.
+//
+//   bundle_extract [--list] BUNDLE|- [DIRECTORY]
+//
+// Files are written to DIRECTORY (default: output) the same way the
+// converter writes them: atomically, and only when their content changed.
+
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include "../source/bundle.hpp"
+#include "../source/custom_exceptions.hpp"
+#include "../source/file_handler.hpp"
+#include "../source/output_directory.hpp"
+
+// Bundles are flat; anything else could write outside the directory
+static bool is_plain_file_name(const std::string &name) {
+  return name.find('/') == std::string::npos && name != "." && name != "..";
+}
+
+int main(int argc, char *argv[]) {
+  bool list_only = false;
+  int first = 1;
+  if (argc > 1 && std::string(argv[1]) == "--list") {
+    list_only = true;
+    first = 2;
+  }
+  if (argc - first < 1 || argc - first > 2) {
+    std::cerr << "Usage: " << argv[0] << " [--list] BUNDLE|- [DIRECTORY]\n";
+    return EXIT_FAILURE;
+  }
+  std::string bundle_path = argv[first];
+  std::string directory_name = argc - first == 2 ? argv[first + 1] : "output";
+
+  try {
+    InputFile input = FileHandler::read_input_file(
+        bundle_path == "-" ? "/dev/stdin" : bundle_path,
+        std::numeric_limits<std::size_t>::max());
+    BundleReader reader(input.view());
+
+    if (list_only) {
+      for (const BundleEntry &entry : reader.entries()) {
+        std::cout << entry.content.size() << "\t" << entry.name << "\n";
+      }
+      return 0;
+    }
+
+    OutputDirectory output(directory_name);
+    for (const BundleEntry &entry : reader.entries()) {
+      if (!is_plain_file_name(entry.name)) {
+        throw IO_Exception(
+            ("Refusing to extract '" + entry.name + "'").c_str());
+      }
+      bool written = output.write_if_changed(entry.name, entry.content);
+      std::cout << "-" << output.file_path(entry.name)
+                << (written ? "" : " (unchanged)") << "\n";
+    }
+    output.commit();
+  } catch (const IO_Exception &e) {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return 0;
+}
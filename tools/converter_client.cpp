@@ -0,0 +1,58 @@
+// Sends a conversion to a server started with "./main --serve" and prints
+// what the converter would have printed, with the same exit status.
+//
+//   converter_client [--socket PATH] [converter options] INPUT...
+//
+// Arguments are the converter's own; "-" sends standard input along.
+// PATH defaults to $CS_CONVERTER_SOCKET, then /tmp/cs_converter-<uid>.sock.
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+#include "../source/conversion_server.hpp"
+#include "../source/custom_exceptions.hpp"
+#include "../source/file_handler.hpp"
+
+static bool write_all(int fd, const std::string &data) {
+  std::size_t written = 0;
+  while (written < data.size()) {
+    ssize_t count = ::write(fd, data.data() + written, data.size() - written);
+    if (count < 0) {
+      return false;
+    }
+    written += static_cast<std::size_t>(count);
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  std::string socket_path = ConversionServer::default_socket_path();
+  int first = 1;
+  if (argc > 2 && std::string(argv[1]) == "--socket") {
+    socket_path = argv[2];
+    first = 3;
+  }
+
+  try {
+    ConversionRequest request;
+    request.working_directory = std::filesystem::current_path().string();
+    for (int i = first; i < argc; i++) {
+      request.arguments.push_back(argv[i]);
+      if (request.arguments.back() == "-") {
+        InputFile input = FileHandler::read_standard_input();
+        request.standard_input = std::string(input.view());
+      }
+    }
+
+    ConversionResponse response = ConversionClient::send(socket_path, request);
+    bool written = write_all(STDERR_FILENO, response.standard_error) &&
+                   write_all(STDOUT_FILENO, response.standard_output);
+    return written ? response.exit_status : EXIT_FAILURE;
+  } catch (const IO_Exception &e) {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+}